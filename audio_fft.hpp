@@ -1,82 +1,309 @@
 #ifndef AUDIO_FFT_HPP
 #define AUDIO_FFT_HPP
-#include <iostream>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <mmdeviceapi.h>
 
-#include "kiss_fft.h"
-#include "kiss_fftr.h"
+#include "audio_source.hpp"
+#include "dsp_kernels.h"
+#include "fft_plan.hpp"
+#include "planar_ring.hpp"
+#include "window.hpp"
 
 #define DEL_ARR(v)                                                             \
   delete[] v;                                                                  \
   v = nullptr;
 
-class AudioFFT {
+// Which signals AudioFFT computes spectra of. Each costs one real fft per
+// hop, so kPerChannel on 7.1 runs eight; they share the plan and scratch.
+enum class ChannelMode {
+  kMono,       // one spectrum of the channel average
+  kPerChannel, // one spectrum per channel
+  kMidSide,    // stereo only: mid (L + R) / 2, then side (L - R) / 2
+};
+
+// How AudioFFT picks its transform length from the window length. Longer
+// transforms zero-pad the window: same time resolution, finer bin spacing.
+enum class FftSize {
+  kExact,      // the window length (made even), radixes above 5 are slow
+  kFast,       // next even size kiss_fft factors into 2, 3 and 5
+  kPowerOfTwo, // next power of two, all radix 2/4 vector stages
+};
+
+// The last `len` frames of every signal of a ChannelMode in a PlanarRing,
+// written from interleaved packets. AudioFFT and MultiResolutionFFT read
+// their windows out of one of these, however many there are.
+class SignalHistory {
 public:
-  AudioFFT(uint32_t len, WAVEFORMATEX *wf)
-      : len_(len), cfg_(nullptr), wave_format_(wf), input_(nullptr),
-        output_(nullptr) {
-    cfg_ = kiss_fftr_alloc(len_, false, nullptr, nullptr);
-    input_ = new float[len_]{0.0f};
-    out_len_ = len_ / 2 + 1;
-    output_ = new kiss_fft_cpx[out_len_];
-
-    w_ptr_ = 0;
-    freq_range_ = new float[out_len_]{0.0f};
-
-    assert(sizeof(float) == wf->wBitsPerSample / 8);
-    channel_datum_ = new float[wf->nChannels]; // NOTE: What is this?
-  }
-  ~AudioFFT() {
-    std::cout << "AudioFFT dtor called\n";
-    DEL_ARR(input_)
-    DEL_ARR(output_)
-    kiss_fft_cleanup();
+  SignalHistory(uint32_t len, const AudioFormat &format, ChannelMode mode)
+      : len_(len), channels_(format.channels), mode_(mode),
+        signals_(SignalCount(format.channels, mode)), history_(signals_, len) {
+    assert(mode != ChannelMode::kMidSide || format.channels == 2);
+    deinterleave_ = GetDeinterleave(format.channels);
+    mul_window_ = GetMulWindow();
+    scratch_ = new float[len_ * 2];
+    planes_ = new float *[format.channels];
   }
+  ~SignalHistory() {
+    DEL_ARR(scratch_)
+    DEL_ARR(planes_)
+  }
+  SignalHistory(const SignalHistory &) = delete;
+  SignalHistory &operator=(const SignalHistory &) = delete;
 
-  uint32_t GetOutputLen() { return this->out_len_; }
-  void GetFreqRange(float *dst) {
-    for (uint32_t i = 0; i < out_len_; i++) {
-      dst[i] = i * wave_format_->nSamplesPerSec / float(len_);
+  uint32_t GetLen() const { return this->len_; }
+  uint32_t GetSignalCount() const { return this->signals_; }
+  // frames Write takes before the rings wrap
+  uint32_t Contiguous() const { return this->history_.Contiguous(); }
+
+  // Split n <= Contiguous() interleaved frames into the rings, copying
+  // channel c to planar[c] unless `planar` is null. Advance(n) then makes
+  // them the newest frames.
+  void Write(const float *data, uint32_t n, float *const *planar) {
+    switch (mode_) {
+    case ChannelMode::kMono:
+      deinterleave_(data, n, channels_, planar, history_.Plane(0));
+      break;
+    case ChannelMode::kPerChannel: {
+      float *const *history = history_.Planes();
+      deinterleave_(data, n, channels_, history, scratch_);
+      for (uint16_t c = 0; planar && c < channels_; c++) {
+        std::copy(history[c], history[c] + n, planar[c]);
+      }
+      break;
     }
-  }
-  template <typename T>
-  void GetAmplitude(T *data, uint32_t &frame_len, float *dst) {
-    for (uint32_t i = 0; i < frame_len; i++, w_ptr_++) {
-      T mono_sum = 0;
-      for (uint16_t c = 0; c < wave_format_->nChannels; c++) {
-        mono_sum += data[(i * wave_format_->nChannels) + c];
+    case ChannelMode::kMidSide: {
+      if (planar == nullptr) {
+        planes_[0] = scratch_;
+        planes_[1] = scratch_ + len_;
+        planar = planes_;
       }
-      input_[w_ptr_] = (float)mono_sum / (float)wave_format_->nChannels;
-
-      if (w_ptr_ == len_ - 1) {
-        // calculate fft
-        kiss_fftr(this->cfg_, this->input_, this->output_);
-        for (uint32_t j = 0; j < this->out_len_; j++) {
-          float amplitude =
-              std::hypot(output_[j].r, output_[j].i) * 2 / (float)len_;
-          // dst[j] = 20 * log10(amplitude / 1);
-          dst[j] = amplitude;
-        }
-        w_ptr_ = 0;
+      deinterleave_(data, n, channels_, planar, history_.Plane(0));
+      float *side = history_.Plane(1);
+      for (uint32_t i = 0; i < n; i++) {
+        side[i] = (planar[0][i] - planar[1][i]) * 0.5f;
       }
+      break;
     }
+    }
+  }
+  void Advance(uint32_t n) { history_.Advance(n); }
+  // forgets every frame written, as after a gap in the input
+  void Clear() { history_.Clear(); }
+
+  // Copy the newest len <= GetLen() frames of signal s oldest first into
+  // the contiguous fft input, windowing on the way so the window costs no
+  // pass of its own.
+  void Unroll(uint32_t s, uint32_t len, const float *w, float *dst) const {
+    mul_window_(history_.Latest(uint16_t(s), len), w, dst, len);
   }
 
 private:
+  static uint32_t SignalCount(uint16_t channels, ChannelMode mode) {
+    return mode == ChannelMode::kPerChannel ? channels
+           : mode == ChannelMode::kMidSide  ? 2
+                                            : 1;
+  }
+
   uint32_t len_;
+  uint16_t channels_;
+  ChannelMode mode_;
+  uint32_t signals_; // see ChannelMode
+  DeinterleaveFn deinterleave_;
+  MulWindowFn mul_window_;
+
+  PlanarRing history_; // len_ samples of each signal
+  float *scratch_;     // 2 * len_, what Write has no other place for
+  float **planes_;     // kernel destinations, one per channel
+};
+
+// One window length of spectra over every signal of a SignalHistory: the
+// window, the shared fft plan and the buffers of one transform. Amplitudes
+// are corrected for the window's coherent gain, a bin centred sine reads
+// its peak amplitude (squared, or in dBFS, depending on the SpectrumScale).
+// The window is `len` frames, transformed at FftLen(len, size) points.
+class FftStage {
+public:
+  FftStage(uint32_t len, uint32_t spectra, WindowType window,
+           float kaiser_beta, FftSize size, SpectrumScale scale)
+      : len_(len), nfft_(FftLen(len, size)), out_len_(nfft_ / 2 + 1),
+        spectra_(spectra) {
+    plan_ = GetFftPlan(FftLayout::kReal, nfft_);
+    fft_scratch_ = new kiss_fft_cpx[plan_->GetScratchLen()];
+    window_ = GetWindow(window, len_, kaiser_beta);
+    magnitude_ = GetSpectrum(scale);
+    scale_ = 2 / (float)len_ / window_->coherent_gain;
+    input_ = new float[nfft_ * spectra_]{0.0f}; // padding stays zero
+    output_re_ = new float[out_len_ * spectra_];
+    output_im_ = new float[out_len_ * spectra_];
+  }
+  ~FftStage() {
+    DEL_ARR(input_)
+    DEL_ARR(output_re_)
+    DEL_ARR(output_im_)
+    DEL_ARR(fft_scratch_)
+  }
+  FftStage(const FftStage &) = delete;
+  FftStage &operator=(const FftStage &) = delete;
+
+  // even transform length for a window of len frames, see FftSize
+  static uint32_t FftLen(uint32_t len, FftSize size) {
+    switch (size) {
+    case FftSize::kFast:
+      // kiss_fftr runs a complex fft of half the length
+      return 2 * (uint32_t)kiss_fft_next_fast_size((int)(len + 1) / 2);
+    case FftSize::kPowerOfTwo: {
+      uint32_t n = 2;
+      while (n < len) {
+        n *= 2;
+      }
+      return n;
+    }
+    default:
+      return len + len % 2;
+    }
+  }
+
+  uint32_t GetLen() const { return this->len_; }
+  uint32_t GetFftLen() const { return this->nfft_; }
+  uint32_t GetOutputLen() const { return this->out_len_; }
+  // the window's noise bandwidth in bins of this (maybe padded) fft
+  float GetNoiseBandwidth() const {
+    return window_->noise_bandwidth * nfft_ / float(len_);
+  }
+  void GetFreqRange(uint32_t sample_rate, float *dst) const {
+    for (uint32_t i = 0; i < out_len_; i++) {
+      dst[i] = i * sample_rate / float(nfft_);
+    }
+  }
+  // Unscaled complex bins of the last Run, spectrum s at s * GetOutputLen()
+  const float *GetBinsRe() const { return this->output_re_; }
+  const float *GetBinsIm() const { return this->output_im_; }
+
+  // Spectra of the newest len frames of `history` into dst, spectrum s at
+  // s * GetOutputLen(); a null `dst` only computes GetBinsRe / GetBinsIm.
+  void Run(const SignalHistory &history, float *dst) {
+    // every signal's window first, then the transforms back to back so the
+    // twiddles stay in cache across channels. Bins come out split into real
+    // and imaginary arrays, so the magnitudes are plain vector loads.
+    const float *w = window_->coeffs.data();
+    for (uint32_t s = 0; s < spectra_; s++) {
+      history.Unroll(s, len_, w, input_ + s * nfft_);
+    }
+    for (uint32_t s = 0; s < spectra_; s++) {
+      kiss_fftr_split_scratch(plan_->Real(), this->input_ + s * nfft_,
+                              this->output_re_ + s * out_len_,
+                              this->output_im_ + s * out_len_,
+                              this->fft_scratch_);
+    }
+    if (dst) {
+      magnitude_(output_re_, output_im_, scale_, dst, out_len_ * spectra_);
+    }
+  }
+
+private:
+  uint32_t len_;  // window
+  uint32_t nfft_; // transform, len_ and zero padding
   uint32_t out_len_;
+  uint32_t spectra_;
 
-  WAVEFORMATEX *wave_format_;
-  float *channel_datum_;
-  kiss_fftr_cfg cfg_;
+  std::shared_ptr<const FftPlan> plan_; // shared by every stage of nfft_
+  kiss_fft_cpx *fft_scratch_;           // what the plan needs per instance
+  std::shared_ptr<const Window> window_;
+  MagnitudeFn magnitude_; // to the SpectrumScale asked for
+  float scale_; // single sided amplitude, window gain compensated
 
-  float *input_;
-  uint32_t w_ptr_;
+  float *input_;     // spectra_ windowed frames of nfft_, zero past len_
+  float *output_re_; // spectra_ spectra of out_len_ bins, real parts
+  float *output_im_; // and imaginary parts
+};
 
-  float *freq_range_;
-  kiss_fft_cpx *output_;
+// Short-time Fourier transform of the mono downmix (or of every channel,
+// see ChannelMode): a spectrum of the last `len` frames every `hop` frames.
+// hop == len gives back to back windows, len / 2 or len / 4 give 50% or 75%
+// overlap, above len the frames between windows go unanalysed. Scaling and
+// fft length as in FftStage.
+// Frames are float whatever `format` says, only its rate and channel count
+// are used; AudioThread converts other sample types before they get here.
+class AudioFFT {
+public:
+  AudioFFT(uint32_t len, const AudioFormat &format, uint32_t hop = 0,
+           WindowType window = WindowType::kRectangular,
+           float kaiser_beta = 8.6f, ChannelMode mode = ChannelMode::kMono,
+           FftSize size = FftSize::kExact,
+           SpectrumScale scale = SpectrumScale::kMagnitude)
+      : history_(len, format, mode),
+        stage_(len, history_.GetSignalCount(), window, kaiser_beta, size,
+               scale),
+        format_(format), hop_(hop == 0 ? len : hop),
+        hop_ptr_(0) {}
+  ~AudioFFT() { kiss_fft_cleanup(); }
+
+  // even transform length for a window of len frames, see FftSize
+  static uint32_t FftLen(uint32_t len, FftSize size) {
+    return FftStage::FftLen(len, size);
+  }
+
+  uint32_t GetOutputLen() { return stage_.GetOutputLen(); }
+  uint32_t GetFftLen() { return stage_.GetFftLen(); }
+  // the window's noise bandwidth in bins of this (maybe padded) fft
+  float GetNoiseBandwidth() { return stage_.GetNoiseBandwidth(); }
+  // spectra per hop, laid out back to back in every `dst`
+  uint32_t GetSpectrumCount() { return history_.GetSignalCount(); }
+  uint32_t GetHop() { return this->hop_; }
+  void GetFreqRange(float *dst) {
+    stage_.GetFreqRange(format_.sample_rate, dst);
+  }
+  // frames still missing before the next spectrum is computed
+  uint32_t FramesUntilReady() { return this->hop_ - this->hop_ptr_; }
+  // frames Write takes before the history wraps
+  uint32_t Contiguous() { return history_.Contiguous(); }
+  // Unscaled complex bins of the last hop, spectrum s at s * GetOutputLen(),
+  // until the next Commit that returns true.
+  const float *GetBinsRe() { return stage_.GetBinsRe(); }
+  const float *GetBinsIm() { return stage_.GetBinsIm(); }
+
+  // Returns true if a hop completed and `dst` holds new spectra, spectrum s
+  // at s * GetOutputLen(). Pass at most FramesUntilReady() frames to see
+  // every hop.
+  bool GetAmplitude(const float *data, uint32_t frame_len, float *dst) {
+    bool ready = false;
+    while (frame_len > 0) {
+      uint32_t n =
+          std::min({frame_len, this->Contiguous(), this->FramesUntilReady()});
+      this->Write(data, n, nullptr);
+      ready |= this->Commit(n, dst);
+      data += n * format_.channels;
+      frame_len -= n;
+    }
+    return ready;
+  }
+
+  // The two halves of GetAmplitude, for callers that want the channels too:
+  // Write splits n <= min(Contiguous(), FramesUntilReady()) interleaved
+  // frames into the history, copying channel c to planar[c] unless
+  // `planar` is null. Commit then returns true if `dst` got spectra; a null
+  // `dst` skips them for callers that only want GetBinsRe / GetBinsIm.
+  void Write(const float *data, uint32_t n, float *const *planar) {
+    history_.Write(data, n, planar);
+  }
+  bool Commit(uint32_t n, float *dst) {
+    history_.Advance(n);
+    hop_ptr_ += n;
+    if (hop_ptr_ < hop_) {
+      return false;
+    }
+    stage_.Run(history_, dst);
+    hop_ptr_ = 0;
+    return true;
+  }
+
+private:
+  SignalHistory history_;
+  FftStage stage_;
+  AudioFormat format_;
+  uint32_t hop_;
+  uint32_t hop_ptr_; // samples since the last fft
 };
 #endif
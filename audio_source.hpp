@@ -0,0 +1,88 @@
+#ifndef AUDIO_SOURCE_HPP
+#define AUDIO_SOURCE_HPP
+
+#include <cstdint>
+
+#include "function_ref.hpp"
+
+// How one sample is stored. PCM with fewer valid bits than its container
+// (24 in 32, 20 in 24) is left justified, so it reads as the container type.
+enum class SampleType : uint8_t {
+  kUnsupported,
+  kFloat32,
+  kFloat64,
+  kInt16,
+  kInt24, // packed, 3 bytes
+  kInt32,
+};
+
+// Sample type from a WAVEFORMATEX(TENSIBLE): `is_float` from the format tag
+// or SubFormat, `container_bits` from wBitsPerSample.
+inline SampleType ToSampleType(bool is_float, uint16_t container_bits) {
+  if (is_float) {
+    return container_bits == 32   ? SampleType::kFloat32
+           : container_bits == 64 ? SampleType::kFloat64
+                                  : SampleType::kUnsupported;
+  }
+  switch (container_bits) {
+  case 16:
+    return SampleType::kInt16;
+  case 24:
+    return SampleType::kInt24;
+  case 32:
+    return SampleType::kInt32;
+  default:
+    return SampleType::kUnsupported;
+  }
+}
+
+// Platform independent description of the interleaved frames a source
+// delivers. Mirrors the WAVEFORMATEX fields the pipeline actually uses.
+struct AudioFormat {
+  uint32_t sample_rate = 0;
+  uint16_t channels = 0;
+  uint16_t bits_per_sample = 0; // container size of a single sample
+  uint16_t valid_bits = 0;      // wValidBitsPerSample, informative only
+  uint16_t block_align = 0;     // bytes of one interleaved frame
+  SampleType sample_type = SampleType::kUnsupported;
+};
+
+// Anything that can feed interleaved frames to AudioThread: the WASAPI
+// loopback device, a WAV file, a synthetic generator...
+class AudioSource {
+public:
+  // Only valid during GetBuffer, which must not keep them. Plain
+  // references, so handing a lambda to GetBuffer allocates nothing.
+  using StopFn = FunctionRef<bool()>;
+  using CallbackFn = FunctionRef<void(uint8_t *, uint32_t)>; // data, frames
+
+  virtual ~AudioSource() = default;
+
+  virtual void StartService() = 0;
+  virtual void StopService() = 0;
+
+  // Wait for the next batch of packets and hand each one to `callback`
+  // until no packet is pending or `stop` returns true. The data pointer is
+  // only valid during the callback.
+  virtual void GetBuffer(StopFn stop, CallbackFn callback) = 0;
+
+  // Sources that make their frames (generators) can write them straight
+  // into the consumer's memory instead, saving GetBuffer's packet copy.
+  // Fill writes up to `max_frames` of the next packet to `dst`, the rest
+  // of a longer packet on the next calls, and returns the frames written:
+  // 0 when `stop` returns true or nothing is left. Only called when
+  // CanFill() is true.
+  virtual bool CanFill() const { return false; }
+  virtual uint32_t Fill(StopFn /*stop*/, uint8_t * /*dst*/,
+                        uint32_t /*max_frames*/) {
+    return 0;
+  }
+
+  virtual const AudioFormat &GetFormat() const = 0;
+
+  // Finite sources (files, fixed length generators) return true once every
+  // frame has been delivered. Live devices never run out.
+  virtual bool IsExhausted() const { return false; }
+};
+
+#endif
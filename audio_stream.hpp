@@ -1,8 +1,8 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
+#include <algorithm>  // max
 #include <cassert>
-#include <functional> // std::function
 #include <iomanip>    // setw
 #include <iostream>   //
 #include <sstream>    // ostringstream
@@ -13,6 +13,8 @@
 #include <Mmdeviceapi.h>
 #include <Windows.h>
 
+#include "audio_source.hpp"
+
 #define PRETTY_LOG(label, var)                                                 \
   std::cout << std::setw(16) << std::left << label << ": " << var << '\n';
 
@@ -28,7 +30,7 @@
 
 inline void PrintWaveFormat(WAVEFORMATEX *wf);
 
-class AudioStream {
+class AudioStream : public AudioSource {
 #define REFTIMES_PER_SEC 10000000 // 100 nanosecond => 10^-7 second
 #define REFTIMES_PER_MILLISEC 10000
   const IID IID_IAudioCaptureClient = __uuidof(IAudioCaptureClient);
@@ -37,13 +39,24 @@ class AudioStream {
   const IID IID_IAudioClient = __uuidof(IAudioClient);
 
 public:
-  AudioStream()
-      : audio_client_(nullptr), capture_client_(nullptr), wave_format_(nullptr),
-        raw_data_(nullptr), frame_max_(0), frame_num_(0), packet_len_(0) {
+  enum class CaptureMode {
+    kPolling, // sleep for half of the buffer, then drain it
+    kEvent,   // wake up every device period, AUDCLNT_STREAMFLAGS_EVENTCALLBACK
+  };
+
+  // `buffer_ms` is the requested device buffer duration. Polling wants it
+  // large since it only wakes twice per buffer, event mode is fine with a
+  // couple of device periods (~10-20 ms).
+  AudioStream(CaptureMode mode = CaptureMode::kPolling,
+              uint32_t buffer_ms = 1000)
+      : mode_(mode), buffer_duration_(buffer_ms * REFTIMES_PER_MILLISEC),
+        audio_client_(nullptr), capture_client_(nullptr), wave_format_(nullptr),
+        sample_ready_(nullptr), raw_data_(nullptr), frame_max_(0),
+        frame_num_(0), packet_len_(0) {
     CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
     this->Initialize();
   }
-  ~AudioStream() {
+  ~AudioStream() override {
     std::cout << "AudioStream dtor called\n";
     this->audio_client_->Stop();
     if (this->audio_client_) {
@@ -52,11 +65,14 @@ public:
     if (this->capture_client_) {
       this->capture_client_->Release();
     }
+    if (this->sample_ready_) {
+      CloseHandle(this->sample_ready_);
+    }
     CoTaskMemFree(this->wave_format_);
     CoUninitialize();
   }
 
-  void StartService() {
+  void StartService() override {
     HRESULT hr;
     hr = this->audio_client_->GetService(IID_IAudioCaptureClient,
                                          (void **)&this->capture_client_);
@@ -66,19 +82,25 @@ public:
     this->sleep_time_ = REFTIMES_PER_SEC * this->frame_max_ /
                         this->wave_format_->nSamplesPerSec /
                         REFTIMES_PER_MILLISEC / 2;
+    this->wait_time_ = std::max<uint64_t>(4 * this->sleep_time_, 100);
   }
-  void StopService() {
+  void StopService() override {
     HRESULT hr;
     hr = this->audio_client_->Stop();
     CHECK_HR(hr, "AudioClient Stop Failed")
   }
 
-  using StopFn = std::function<bool()>;
-  using CallbackFn =
-      std::function<void(uint8_t *, uint32_t)>; // data, frame count
-  void GetBuffer(StopFn stop, CallbackFn callback) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_));
-    this->capture_client_->ReleaseBuffer(this->frame_num_);
+  void GetBuffer(StopFn stop, CallbackFn callback) override {
+    if (this->mode_ == CaptureMode::kEvent) {
+      // time out now and then so the caller gets to check its stop flag
+      if (WaitForSingleObject(this->sample_ready_, (DWORD)this->wait_time_) !=
+          WAIT_OBJECT_0) {
+        return;
+      }
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_));
+      this->capture_client_->ReleaseBuffer(this->frame_num_);
+    }
     this->capture_client_->GetNextPacketSize(&this->packet_len_);
     while (this->packet_len_ != 0 && !stop()) {
       this->capture_client_->GetBuffer(&this->raw_data_, &this->frame_num_,
@@ -94,6 +116,7 @@ public:
   }
 
   WAVEFORMATEX *GetWaveFormat() { return this->wave_format_; }
+  const AudioFormat &GetFormat() const override { return this->format_; }
 
 private:
   void Initialize() {
@@ -114,14 +137,46 @@ private:
     hr = this->audio_client_->GetMixFormat(&this->wave_format_);
     CHECK_HR(hr, "AudioClient GetMixFormat Failed")
 
-    hr = this->audio_client_->Initialize(
-        AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK,
-        REFTIMES_PER_SEC, 0, this->wave_format_, NULL);
+    DWORD stream_flags = AUDCLNT_STREAMFLAGS_LOOPBACK;
+    if (this->mode_ == CaptureMode::kEvent) {
+      stream_flags |= AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+    }
+    hr = this->audio_client_->Initialize(AUDCLNT_SHAREMODE_SHARED, stream_flags,
+                                         this->buffer_duration_, 0,
+                                         this->wave_format_, NULL);
     CHECK_HR(hr, "AudioClient Initialize Failed")
 
+    if (this->mode_ == CaptureMode::kEvent) {
+      this->sample_ready_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+      hr = this->audio_client_->SetEventHandle(this->sample_ready_);
+      CHECK_HR(hr, "AudioClient SetEventHandle Failed")
+    }
+
     hr = this->audio_client_->GetBufferSize(&this->frame_max_);
     CHECK_HR(hr, "AudioClient GetBufferSize Failed")
 
+    this->format_.sample_rate = this->wave_format_->nSamplesPerSec;
+    this->format_.channels = this->wave_format_->nChannels;
+    this->format_.bits_per_sample = this->wave_format_->wBitsPerSample;
+    this->format_.valid_bits = this->wave_format_->wBitsPerSample;
+    this->format_.block_align = this->wave_format_->nBlockAlign;
+    WORD tag = this->wave_format_->wFormatTag;
+    bool is_float = tag == WAVE_FORMAT_IEEE_FLOAT;
+    bool is_pcm = tag == WAVE_FORMAT_PCM;
+    if (tag == WAVE_FORMAT_EXTENSIBLE) {
+      auto *ext = (WAVEFORMATEXTENSIBLE *)this->wave_format_;
+      is_float = ext->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+      is_pcm = ext->SubFormat == KSDATAFORMAT_SUBTYPE_PCM;
+      if (ext->Samples.wValidBitsPerSample != 0) {
+        this->format_.valid_bits = ext->Samples.wValidBitsPerSample;
+      }
+    }
+    // anything else (a-law, mu-law, ...) is not linear samples at all
+    this->format_.sample_type =
+        is_float || is_pcm
+            ? ToSampleType(is_float, this->wave_format_->wBitsPerSample)
+            : SampleType::kUnsupported;
+
     PrintWaveFormat(this->wave_format_);
     PRETTY_LOG("Max Frame num", this->frame_max_)
 
@@ -129,10 +184,16 @@ private:
     device->Release();
   }
 
+  CaptureMode mode_;
+  REFERENCE_TIME buffer_duration_;
+
   IAudioClient *audio_client_;
   IAudioCaptureClient *capture_client_;
   WAVEFORMATEX *wave_format_;
+  AudioFormat format_;
+  HANDLE sample_ready_; // signaled every device period in event mode
   uint64_t sleep_time_;
+  uint64_t wait_time_;
 
   uint32_t buffer_flag;
   uint32_t frame_max_;
@@ -142,6 +203,20 @@ private:
   uint8_t *raw_data_;
 };
 
+// Plain WAVEFORMATEX for the frames a source delivers, e.g. for WaveWriter
+inline WAVEFORMATEX ToWaveFormat(const AudioFormat &f) {
+  WAVEFORMATEX wf = {};
+  bool is_float = f.sample_type == SampleType::kFloat32 ||
+                  f.sample_type == SampleType::kFloat64;
+  wf.wFormatTag = is_float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+  wf.nChannels = f.channels;
+  wf.nSamplesPerSec = f.sample_rate;
+  wf.nAvgBytesPerSec = f.sample_rate * f.block_align;
+  wf.nBlockAlign = f.block_align;
+  wf.wBitsPerSample = f.bits_per_sample;
+  return wf;
+}
+
 inline void PrintWaveFormat(WAVEFORMATEX *wf) {
   PRETTY_LOG("nSamplesPerSec", wf->nSamplesPerSec)
   PRETTY_LOG("nChannels", wf->nChannels)
@@ -1,155 +1,621 @@
 #include "audio_thread.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iomanip>
 #include <stdexcept>
 
-AudioThread::AudioThread(uint32_t hz_gap) : stop_(false), pause_(false) {
-  this->audio_stream_ = new AudioStream();
-  uint32_t fft_win =
-      this->audio_stream_->GetWaveFormat()->nSamplesPerSec / hz_gap;
-  this->audio_fft_ = new AudioFFT(fft_win % 2 == 0 ? fft_win : fft_win - 1,
-                                  this->audio_stream_->GetWaveFormat());
-  this->amplitude_len_ = audio_fft_->GetOutputLen();
-  this->amplitude_ = new float[amplitude_len_];
-  for (uint32_t i = 0; i < amplitude_len_; i++) {
-    this->amplitude_[i] = -120.0;
-  }
+#ifdef _WIN32
+#include "audio_stream.hpp"
 
-  auto channels = this->audio_stream_->GetWaveFormat()->nChannels;
+AudioThread::AudioThread(uint32_t hz_gap)
+    : AudioThread(hz_gap, new AudioStream()) {}
+#endif
 
-  this->raws_ = new float *[channels];
-  for (int c = 0; c < channels; c++) {
-    this->raws_[c] = new float[fft_win];
-    for (uint32_t i = 0; i < fft_win; i++) {
-      this->raws_[c][i] = 0.0;
-    }
+static AnalysisConfig GapConfig(uint32_t hz_gap) {
+  AnalysisConfig config;
+  config.hz_gap = hz_gap;
+  return config;
+}
+
+AudioThread::AudioThread(uint32_t hz_gap, AudioSource *source)
+    : AudioThread(GapConfig(hz_gap), source) {}
+
+// everything the constructor cannot run with, before it allocates
+static void CheckConfig(const AnalysisConfig &config,
+                        const AudioFormat &format) {
+  if (format.sample_type == SampleType::kUnsupported) {
+    throw std::runtime_error("Unsupported sample format");
+  }
+  if (config.hz_gap == 0 || config.hz_gap > format.sample_rate / 2) {
+    throw std::runtime_error("hz_gap must be in (0, sample rate / 2]");
+  }
+  if (config.channel_mode == ChannelMode::kMidSide && format.channels != 2) {
+    throw std::runtime_error("Mid/side analysis needs a stereo source");
+  }
+  if (config.constant_q && config.bands != BandScale::kNone) {
+    throw std::runtime_error("Bands and constant-Q bins are exclusive");
+  }
+}
+
+AudioThread::AudioThread(const AnalysisConfig &config, AudioSource *source)
+    : capture_done_(false), state_(RunState::kIdle), finished_(false),
+      audio_source_(source) {
+  // members own what they point to, so a throw from here on frees them
+  // and the source
+  const AudioFormat &format = this->audio_source_->GetFormat();
+  CheckConfig(config, format);
+  uint32_t fft_win = format.sample_rate / config.hz_gap;
+  uint32_t fft_len = fft_win % 2 == 0 ? fft_win : fft_win - 1;
+  if (config.constant_q) {
+    fft_len = ConstantQ::FftLen(*config.constant_q, format.sample_rate);
+  }
+  uint32_t hop = config.hop;
+  if (hop == 0) {
+    hop = std::max(1u, uint32_t(std::lround(fft_len * (1.0 - config.overlap))));
+  }
+  // bands are sums of bin powers, constant-Q bins sums of complex ones;
+  // both are converted to the asked scale afterwards
+  const bool banded = config.bands != BandScale::kNone;
+  std::vector<ResolutionConfig> resolutions = {
+      {fft_len, hop, config.window, config.kaiser_beta, config.fft_size,
+       banded ? SpectrumScale::kPower : config.scale}};
+  if (config.constant_q) {
+    resolutions[0] = {fft_len, hop, WindowType::kRectangular};
   }
+  resolutions.insert(resolutions.end(), config.resolutions.begin(),
+                     config.resolutions.end());
+  this->audio_fft_ = std::make_unique<MultiResolutionFFT>(
+      resolutions, format, config.channel_mode);
+  this->fft_dst_.resize(resolutions.size());
+  this->amplitude_len_ = audio_fft_->GetOutputLen(0);
+  this->spectrum_count_ = audio_fft_->GetSpectrumCount();
+  this->mapped_scale_ = config.scale;
+  if (config.constant_q) {
+    this->constant_q_ =
+        std::make_unique<ConstantQ>(*config.constant_q, format.sample_rate);
+    this->amplitude_len_ = constant_q_->GetBinCount();
+  }
+  if (banded) {
+    std::vector<float> freqs(amplitude_len_);
+    audio_fft_->GetFreqRange(0, freqs.data());
+    this->band_mapper_ = std::make_unique<BandMapper>(
+        config.bands, freqs.data(), amplitude_len_, config.mel_bands);
+    this->bins_.resize(amplitude_len_ * spectrum_count_);
+    this->band_gain_ = 1.0f / audio_fft_->GetNoiseBandwidth(0);
+    this->amplitude_len_ = band_mapper_->GetBandCount();
+  }
+  Spectrum spectrum_init;
+  // silence until the first window completes
+  const float silence =
+      config.scale == SpectrumScale::kDecibels ? kDecibelFloor : 0.0f;
+  spectrum_init.amplitude.assign(amplitude_len_ * spectrum_count_, silence);
+  const SmoothingConfig &smoothing = config.smoothing;
+  if (smoothing.average > 1 || smoothing.attack > 0.0f ||
+      smoothing.release > 0.0f || smoothing.peaks) {
+    this->smoother_ = std::make_unique<SpectrumSmoother>(
+        smoothing, amplitude_len_ * spectrum_count_,
+        float(hop) / format.sample_rate, silence);
+  }
+  if (smoothing.peaks) {
+    spectrum_init.peak = spectrum_init.amplitude;
+  }
+  spectrum_init.frame_id = 0;
+  spectrum_init.sample_pos = 0;
+  this->spectrum_ = std::make_unique<TripleBuffer<Spectrum>>(spectrum_init);
+  for (uint32_t r = 1; r < resolutions.size(); r++) {
+    Spectrum bins_init;
+    bins_init.amplitude.assign(
+        audio_fft_->GetOutputLen(r) * spectrum_count_,
+        resolutions[r].scale == SpectrumScale::kDecibels ? kDecibelFloor
+                                                         : 0.0f);
+    bins_init.frame_id = 0;
+    bins_init.sample_pos = 0;
+    this->resolutions_.push_back(
+        std::make_unique<TripleBuffer<Spectrum>>(bins_init));
+  }
+  this->resolution_seq_.assign(resolutions_.size(), 1);
+
+  auto channels = format.channels;
+
   this->raw_len_ = fft_win; // This could be anything else
-  this->raw_ptr_ = 0;
+  this->raws_ =
+      std::make_unique<PlanarRing>(channels, raw_len_ + audio_fft_->GetHop(0));
+  this->raw_seq_ = 1; // nothing published
+  this->raw_pos_ = 0;
+  this->raw_frame_id_ = 0;
+  this->raw_sample_pos_ = 0;
+  this->raw_free_ = UINT32_MAX;
+  this->raw_copy_.raws.assign(size_t(channels) * raw_len_, 0.0f);
+  this->raw_copy_.frame_id = 0;
+  this->raw_copy_.sample_pos = 0;
+  this->raw_copy_.seq = 1;
+  this->raw_scratch_.resize(raw_copy_.raws.size());
+  this->convert_ = nullptr;
+  if (format.sample_type != SampleType::kFloat32) {
+    this->convert_ = GetConvert(format.sample_type);
+    this->converted_.resize(kConvertFrames * channels);
+  }
 
-#ifdef DEBUG
-  w_writer_.Initialize(
-      "test_1.wav",
-      (audio_stream_->GetWaveFormat()->wFormatTag == WAVE_FORMAT_EXTENSIBLE));
-#endif
-}
-AudioThread::~AudioThread() {
-  this->Stop();
-  delete[] this->amplitude_;
-  for (int c = 0; c < this->audio_stream_->GetWaveFormat()->nChannels; c++) {
-    delete[] this->raws_[c];
+  AudioFrame frame_init;
+  frame_init.amplitude.resize(amplitude_len_ * spectrum_count_);
+  frame_init.raws.resize(channels * raw_len_);
+  this->frames_ =
+      std::make_unique<SpscRing<AudioFrame>>(kFrameQueueLen, frame_init);
+  this->coalesce_ = false;
+  this->coalescing_ = false;
+  this->pool_ = config.pool;
+  this->pool_hints_ = config.pool_hints;
+  this->stream_ = 0;
+  if (config.pipeline || config.pool) {
+    PipelineConfig pipeline = config.pipeline.value_or(PipelineConfig{});
+    this->pipeline_ =
+        std::make_unique<PacketPipeline>(pipeline, format.block_align);
+    this->coalesce_ = pipeline.backpressure == Backpressure::kCoalesce;
   }
-  delete[] this->raws_;
+  this->frame_seq_ = 1;
+  this->sample_pos_ = 0;
+  this->dropped_frames_ = 0;
 
-  delete this->audio_stream_;
-  delete this->audio_fft_;
-  this->audio_stream_ = nullptr;
-  this->audio_fft_ = nullptr;
+#if defined(DEBUG) && defined(_WIN32)
+  w_writer_.Initialize("test_1.wav", false);
+#endif
 }
+AudioThread::~AudioThread() { this->Stop(); }
 
 void AudioThread::Start() {
   if (this->thread_) {
     LOG("Already Start the thread. Skip!");
     return;
   }
-  this->audio_stream_->StartService();
+  this->audio_source_->StartService();
 
   LOG("Start thread")
-  this->thread_ = std::thread(std::bind(&AudioThread::Run, this));
-  this->stop_ = false;
-  this->pause_ = false;
+  this->state_ = RunState::kRunning;
+  this->capture_done_ = false;
+  if (this->pool_) {
+    this->stream_ = this->pool_->Register(&AudioThread::AnalyseJob, this,
+                                          this->pool_hints_);
+  }
+  this->thread_ = std::thread(&AudioThread::Run, this);
+  if (this->pipeline_ && this->pool_ == nullptr) {
+    this->worker_ = std::thread(&AudioThread::Analyse, this);
+  }
 }
 
 void AudioThread::Pause() {
-  if (this->thread_) {
+  RunState running = RunState::kRunning;
+  if (this->state_.compare_exchange_strong(running, RunState::kPaused)) {
     LOG("Pause thread")
-    this->pause_ = true;
   }
 }
 
 void AudioThread::Resume() {
-  if (this->thread_) {
+  RunState paused = RunState::kPaused;
+  if (this->state_.compare_exchange_strong(paused, RunState::kRunning)) {
     LOG("Resume thread")
-    this->pause_ = false;
+    // under the lock, so the wakeup cannot fall between the capture
+    // thread's check of state_ and its wait
+    std::lock_guard<std::mutex> lock(this->mutex_);
     this->cv_.notify_all();
   }
 }
 
 void AudioThread::Stop() {
-  if (this->thread_ && !this->stop_) {
-    this->pause_ = false;
-    this->stop_ = true;
-    this->cv_.notify_all();
-
+  if (this->thread_) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->state_ = RunState::kStopping;
+      this->cv_.notify_all();
+    }
     this->thread_->join();
     this->thread_ = {};
+    if (this->worker_) {
+      this->worker_->join(); // after what was captured is analysed
+      this->worker_ = {};
+    }
+    if (this->pool_) {
+      // no job runs after this, what it left is analysed here
+      this->pool_->Unregister(this->stream_);
+      this->Drain();
+      this->finished_ = this->audio_source_->IsExhausted();
+    }
+    this->state_ = RunState::kIdle;
 
-#ifdef DEBUG
-    w_writer_.FinalizeHeader(audio_stream_->GetWaveFormat(), total_frame_len_);
+#if defined(DEBUG) && defined(_WIN32)
+    WAVEFORMATEX wf = ToWaveFormat(audio_source_->GetFormat());
+    w_writer_.FinalizeHeader(&wf, total_frame_len_);
 #endif
-    this->audio_stream_->StopService();
+    this->audio_source_->StopService();
+    this->FlushLog();
     LOG("Thread Stopped")
   }
 }
 
+bool AudioThread::IsFinished() { return this->finished_; }
+
+void AudioThread::FlushLog(std::ostream &os) { this->log_.Flush(os); }
+
 void AudioThread::Run() {
-  LOG("--> Enter Thread ID: " << std::this_thread::get_id());
-  while (!this->stop_) {
-    this->audio_stream_->GetBuffer([&] { return this->stop_.load(); },
-                                   [&](uint8_t *data, uint32_t frame_len) {
-                                     this->ProcessBuffer(data, frame_len);
-                                   });
+  const uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+  log_.Push("--> Enter capture thread ", id);
+  while (!this->audio_source_->IsExhausted()) {
+    RunState state = this->state_.load(std::memory_order_acquire);
+    if (state == RunState::kStopping) {
+      break;
+    }
+    if (state == RunState::kPaused) {
+      // parked between packets, never inside ProcessBuffer
+      std::unique_lock<std::mutex> lock(this->mutex_);
+      this->cv_.wait(lock, [&] { return state_ != RunState::kPaused; });
+      continue;
+    }
+    if (this->pipeline_ && this->audio_source_->CanFill()) {
+      // the source writes straight into a block, one block per pass
+      uint8_t *dst = this->pipeline_->BeginPush();
+      this->pipeline_->CommitPush(this->audio_source_->Fill(
+          [&] {
+            return state_.load(std::memory_order_relaxed) !=
+                   RunState::kRunning;
+          },
+          dst, this->pipeline_->GetBlockFrames()));
+      this->WakeAnalysis();
+      continue;
+    }
+    // a pause or stop request ends the packet loop at the next packet
+    this->audio_source_->GetBuffer(
+        [&] {
+          return state_.load(std::memory_order_relaxed) != RunState::kRunning;
+        },
+        [&](uint8_t *data, uint32_t frame_len) {
+          if (this->pipeline_) {
+            this->pipeline_->Push(data, frame_len);
+            this->WakeAnalysis();
+          } else {
+            this->ProcessBuffer(data, frame_len);
+          }
+        });
+  }
+  if (this->pipeline_ == nullptr) {
+    this->finished_ = this->audio_source_->IsExhausted();
+  }
+  this->capture_done_.store(true, std::memory_order_release);
+  if (this->pipeline_) {
+    this->WakeAnalysis(); // to set finished_
+  }
+  log_.Push("--> Exit capture thread ", id);
+}
+
+void AudioThread::WakeAnalysis() {
+  if (this->pool_) {
+    this->pool_->Signal(this->stream_);
+  } else {
+    this->analyse_wake_.Notify();
+  }
+}
+
+void AudioThread::Analyse() {
+  while (true) {
+    // before looking, so what is queued after the look still wakes us
+    const uint32_t seen = this->analyse_wake_.Prepare();
+    // read first: once it is set, an empty pipeline stays empty
+    bool done = this->capture_done_.load(std::memory_order_acquire);
+    if (this->Drain() && done) {
+      break;
+    }
+    this->analyse_wake_.Wait(seen);
+  }
+  this->finished_ = this->audio_source_->IsExhausted();
+}
+
+void AudioThread::AnalyseJob(void *self) {
+  AudioThread *t = static_cast<AudioThread *>(self);
+  bool done = t->capture_done_.load(std::memory_order_acquire);
+  if (!t->Drain(kBlocksPerJob)) {
+    // the pool runs the job again after its turn
+    t->pool_->Signal(t->stream_);
+  } else if (done) {
+    t->finished_ = t->audio_source_->IsExhausted();
+  }
+}
+
+bool AudioThread::Drain(uint32_t max_blocks) {
+  PacketPipeline::Block block;
+  for (uint32_t i = 0; i < max_blocks; i++) {
+    if (!this->pipeline_->Pop(block)) {
+      return true;
+    }
+    if (block.first_frame != this->sample_pos_) {
+      this->SkipLost(block.first_frame - this->sample_pos_);
+    }
+    this->coalescing_ = this->coalesce_ && this->pipeline_->Backlog() > 0;
+    this->ProcessBuffer(block.data, block.frames);
+    this->pipeline_->Release(block);
   }
-  LOG("--> Exit Thread ID: " << std::this_thread::get_id());
+  return this->pipeline_->Backlog() == 0;
 }
 
-void AudioThread::ProcessBuffer(uint8_t *raw_data, uint32_t frame_len) {
-  // pause this thread
-  if (this->pause_) {
-    std::unique_lock<std::mutex> locker(this->mutex_);
-    this->cv_.wait(locker);
-    locker.unlock();
+void AudioThread::SkipLost(uint64_t frames) {
+  // sample positions stay on the capture clock, and no window mixes audio
+  // from both sides of the gap: the analysis starts over from silence and
+  // every sequence skips one id, so readers see where it happened
+  sample_pos_ += frames;
+  audio_fft_->Restart();
+  if (smoother_) {
+    smoother_->Reset();
+  }
+  this->InvalidateRaw();
+  raws_->Clear();
+  frame_seq_++;
+  for (uint64_t &seq : resolution_seq_) {
+    seq++;
   }
+}
 
-#ifdef DEBUG
+void AudioThread::InvalidateRaw() {
+  uint64_t seq = raw_seq_.load(std::memory_order_relaxed);
+  if ((seq & 1) == 0) {
+    raw_seq_.store(seq + 1, std::memory_order_relaxed);
+    // no write to the window moves above the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  raw_free_ = UINT32_MAX;
+}
+
+void AudioThread::ProcessBuffer(const uint8_t *raw_data, uint32_t frame_len) {
+#if defined(DEBUG) && defined(_WIN32)
   // write buffer to wav file
   total_frame_len_ += frame_len;
   w_writer_.WriteWaveData(
-      data, frame_len * audio_stream_->GetWaveFormat()->nBlockAlign);
+      raw_data, frame_len * audio_source_->GetFormat().block_align);
 #endif
 
-  // Get raw data to each channels
-  float *tmp_raw_data = (float *)raw_data;
-  for (uint32_t i = 0; i < frame_len; i++, raw_ptr_++) {
-    for (uint16_t c = 0; c < audio_stream_->GetWaveFormat()->nChannels; c++) {
-      raws_[c][raw_ptr_] =
-          tmp_raw_data[(i * audio_stream_->GetWaveFormat()->nChannels) + c];
+  if (this->convert_ == nullptr) {
+    this->ProcessFrames((const float *)raw_data, frame_len);
+    return;
+  }
+  // everything else goes through float in chunks of a fixed size, so no
+  // packet size makes the capture thread allocate
+  const AudioFormat &format = audio_source_->GetFormat();
+  while (frame_len > 0) {
+    uint32_t n = std::min(frame_len, kConvertFrames);
+    this->convert_(raw_data, n * format.channels, this->converted_.data());
+    this->ProcessFrames(this->converted_.data(), n);
+    raw_data += n * format.block_align;
+    frame_len -= n;
+  }
+}
+
+void AudioThread::ProcessFrames(const float *data, uint32_t frame_len) {
+  const uint16_t channels = audio_source_->GetFormat().channels;
+  while (frame_len > 0) {
+    // split the packet at window ends so each published frame carries the
+    // raw samples up to exactly the end of its window, and at the ends of
+    // both rings so the kernel writes contiguous runs
+    uint32_t n = std::min({frame_len, audio_fft_->FramesUntilReady(),
+                           audio_fft_->Contiguous(), raws_->Contiguous()});
+
+    if (n > raw_free_) {
+      this->InvalidateRaw(); // a hop went by unpublished
+    } else if (raw_free_ != UINT32_MAX) {
+      raw_free_ -= n;
+    }
+    // raw data to each channel and the fft's history in one pass
+    audio_fft_->Write(data, n, raws_->Planes());
+    raws_->Advance(n);
+    sample_pos_ += n;
+
+    // the fft writes straight into the spectrum buffers readers will get,
+    // or the band mapper / constant-Q kernels do from the fft's bins
+    float *amplitude = spectrum_->Back().amplitude.data();
+    fft_dst_[0] = band_mapper_ ? bins_.data()
+                  : constant_q_ ? nullptr
+                                : amplitude;
+    for (uint32_t r = 1; r < fft_dst_.size(); r++) {
+      fft_dst_[r] = resolutions_[r - 1]->Back().amplitude.data();
     }
-    if (raw_ptr_ == raw_len_ - 1) {
-      raw_ptr_ = 0;
+    uint32_t ready = audio_fft_->Commit(n, fft_dst_.data(), !coalescing_);
+    if (coalescing_ && ready) {
+      // newer blocks are waiting: these spectra would be stale on arrival,
+      // readers see the gap in frame ids
+      uint32_t windows = 0;
+      for (uint32_t mask = ready; mask; mask &= mask - 1) {
+        windows++;
+      }
+      pipeline_->AddCoalescedWindows(windows);
+      frame_seq_ += ready & 1;
+      for (uint32_t r = 1; r < fft_dst_.size(); r++) {
+        resolution_seq_[r - 1] += (ready >> r) & 1;
+      }
+      ready = 0;
     }
+    if ((ready & 1) && (band_mapper_ || constant_q_)) {
+      const uint32_t bins = audio_fft_->GetOutputLen(0);
+      for (uint32_t s = 0; s < spectrum_count_; s++) {
+        float *dst = amplitude + s * amplitude_len_;
+        if (band_mapper_) {
+          band_mapper_->Apply(bins_.data() + s * bins, dst, band_gain_,
+                              mapped_scale_);
+        } else {
+          constant_q_->Apply(audio_fft_->GetBinsRe(0) + s * bins,
+                             audio_fft_->GetBinsIm(0) + s * bins, dst,
+                             mapped_scale_);
+        }
+      }
+    }
+    if (ready & 1) {
+      this->PublishFrame();
+    }
+    for (uint32_t r = 1; r < fft_dst_.size(); r++) {
+      if (ready & (1u << r)) {
+        this->PublishResolution(r);
+      }
+    }
+    data += n * channels;
+    frame_len -= n;
+  }
+}
+
+void AudioThread::PublishFrame() {
+  uint64_t seq = frame_seq_++;
+  Spectrum &spectrum = spectrum_->Back();
+  if (smoother_) {
+    smoother_->Apply(spectrum.amplitude.data(), spectrum.peak.data());
+  }
+  spectrum.frame_id = seq;
+  spectrum.sample_pos = sample_pos_;
+  spectrum.timestamp = std::chrono::steady_clock::now();
+
+  AudioFrame *frame = frames_->BeginPush();
+  if (frame == nullptr) {
+    // reader is behind, never wait for it
+    dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    frame->seq = seq;
+    frame->sample_pos = sample_pos_;
+    frame->amplitude = spectrum.amplitude;
+    for (uint16_t c = 0; c < audio_source_->GetFormat().channels; c++) {
+      // already in order, one copy per channel
+      const float *raw = raws_->Latest(c, raw_len_);
+      std::copy(raw, raw + raw_len_, frame->raws.data() + c * raw_len_);
+    }
+    frames_->CommitPush();
+  }
+  // AcquireRaw copies the window out of the ring itself
+  this->InvalidateRaw();
+  raw_pos_.store(raws_->GetPos(), std::memory_order_relaxed);
+  raw_frame_id_.store(seq, std::memory_order_relaxed);
+  raw_sample_pos_.store(sample_pos_, std::memory_order_relaxed);
+  raw_seq_.store(raw_seq_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  raw_free_ = raws_->GetCapacity() - raw_len_;
+  spectrum_->Publish();
+}
+
+void AudioThread::PublishResolution(uint32_t r) {
+  Spectrum &spectrum = resolutions_[r - 1]->Back();
+  spectrum.frame_id = resolution_seq_[r - 1]++;
+  spectrum.sample_pos = sample_pos_;
+  spectrum.timestamp = std::chrono::steady_clock::now();
+  resolutions_[r - 1]->Publish();
+}
+
+const AudioFrame *AudioThread::ReadFrame() { return this->frames_->Front(); }
+
+void AudioThread::ReleaseFrame() {
+  if (this->frames_->Front()) {
+    this->frames_->Pop();
   }
+}
 
-  // TODO: base on type cast to different type
-  audio_fft_->GetAmplitude((float *)raw_data, frame_len, this->amplitude_);
+uint64_t AudioThread::GetDroppedFrames() { return this->dropped_frames_; }
+
+PipelineStats AudioThread::GetPipelineStats() {
+  if (this->pipeline_ == nullptr) {
+    return {0, 0, 0, 0, 0};
+  }
+  return this->pipeline_->GetStats();
 }
 
 uint32_t AudioThread::GetAmplitudeLen() { return this->amplitude_len_; }
 
-void AudioThread::GetAmplitude(float *dst) {
-  // std::unique_lock<std::mutex> locker(this->mutex_);
-  std::copy(this->amplitude_, this->amplitude_ + this->amplitude_len_, dst);
+uint32_t AudioThread::GetSpectrumCount() { return this->spectrum_count_; }
+
+SpectrumView AudioThread::AcquireAmplitude() {
+  this->spectrum_->Update();
+  const Spectrum &spectrum = this->spectrum_->Front();
+  return {spectrum.amplitude.data(),
+          spectrum.peak.empty() ? nullptr : spectrum.peak.data(),
+          this->amplitude_len_,
+          this->spectrum_count_, spectrum.frame_id, spectrum.sample_pos,
+          spectrum.timestamp};
+}
+
+void AudioThread::GetAmplitude(float *dst) { this->GetAmplitude(dst, 0); }
+
+void AudioThread::GetAmplitude(float *dst, uint16_t channel) {
+  SpectrumView view = this->AcquireAmplitude();
+  const float *src = view.data + channel * view.len;
+  std::copy(src, src + view.len, dst);
+}
+
+void AudioThread::GetFreqRange(float *dst) {
+  if (band_mapper_) {
+    band_mapper_->GetCenters(dst);
+    return;
+  }
+  if (constant_q_) {
+    constant_q_->GetCenters(dst);
+    return;
+  }
+  audio_fft_->GetFreqRange(0, dst);
+}
+
+uint32_t AudioThread::GetResolutionCount() {
+  return this->audio_fft_->GetResolutionCount();
 }
 
-void AudioThread::GetFreqRange(float *dst) { audio_fft_->GetFreqRange(dst); }
+SpectrumView AudioThread::AcquireAmplitude(uint32_t resolution) {
+  if (resolution == 0) {
+    return this->AcquireAmplitude();
+  }
+  TripleBuffer<Spectrum> *buffer = this->resolutions_[resolution - 1].get();
+  buffer->Update();
+  const Spectrum &spectrum = buffer->Front();
+  return {spectrum.amplitude.data(),
+          nullptr,
+          this->audio_fft_->GetOutputLen(resolution),
+          this->spectrum_count_,
+          spectrum.frame_id,
+          spectrum.sample_pos,
+          spectrum.timestamp};
+}
+
+void AudioThread::GetFreqRange(float *dst, uint32_t resolution) {
+  if (resolution == 0) {
+    this->GetFreqRange(dst);
+    return;
+  }
+  this->audio_fft_->GetFreqRange(resolution, dst);
+}
 
 uint16_t AudioThread::GetChannels() {
-  return this->audio_stream_->GetWaveFormat()->nChannels;
+  return this->audio_source_->GetFormat().channels;
 }
 
 uint32_t AudioThread::GetRawLen() { return this->raw_len_; }
 
+RawView AudioThread::AcquireRaw() {
+  const uint16_t channels = this->audio_source_->GetFormat().channels;
+  // a few tries against a capture thread moving on, then the last copy
+  for (int attempt = 0; attempt < 4; attempt++) {
+    uint64_t seq = raw_seq_.load(std::memory_order_acquire);
+    if ((seq & 1) || seq == raw_copy_.seq) {
+      break; // being rewritten, or nothing newer
+    }
+    uint32_t pos = raw_pos_.load(std::memory_order_relaxed);
+    uint64_t frame_id = raw_frame_id_.load(std::memory_order_relaxed);
+    uint64_t sample_pos = raw_sample_pos_.load(std::memory_order_relaxed);
+    for (uint16_t c = 0; c < channels; c++) {
+      const float *raw = raws_->LatestAt(c, raw_len_, pos);
+      std::copy(raw, raw + raw_len_, raw_scratch_.data() + c * raw_len_);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (raw_seq_.load(std::memory_order_relaxed) == seq) {
+      raw_copy_.raws.swap(raw_scratch_);
+      raw_copy_.frame_id = frame_id;
+      raw_copy_.sample_pos = sample_pos;
+      raw_copy_.seq = seq;
+      break;
+    }
+  }
+  return {raw_copy_.raws.data(), this->raw_len_, channels, raw_copy_.frame_id,
+          raw_copy_.sample_pos};
+}
+
 void AudioThread::GetRaw(float *dst, uint16_t c) {
-  std::copy(this->raws_[c], this->raws_[c] + this->raw_len_, dst);
+  RawView view = this->AcquireRaw();
+  const float *raw = view.data + c * view.len;
+  std::copy(raw, raw + view.len, dst);
 }
@@ -4,66 +4,273 @@
 #include <iostream>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <stdint.h>
 #include <thread>
 #include <vector>
 
-// Wasapi
-#include <Windows.h>
-
 #include "audio_fft.hpp"
-#include "audio_stream.hpp"
+#include "audio_source.hpp"
+#include "band_mapper.hpp"
+#include "constant_q.hpp"
+#include "deferred_log.hpp"
+#include "dsp_kernels.h"
+#include "multi_resolution_fft.hpp"
+#include "packet_pipeline.hpp"
+#include "planar_ring.hpp"
+#include "spectrum_smoother.hpp"
+#include "spsc_ring.hpp"
+#include "task_pool.hpp"
+#include "triple_buffer.hpp"
+#include "wake_word.hpp"
 
-#ifdef DEBUG
+#if defined(DEBUG) && defined(_WIN32)
 #include "wave_writer.h"
 #endif
 
+// control thread only, the capture thread logs through AudioThread::log_
 #define LOG(x) std::cout << x << '\n';
 
+// How AudioThread analyses the captured frames.
+struct AnalysisConfig {
+  uint32_t hz_gap = 100; // bin spacing, sets the fft window length
+  float overlap = 0.0f;  // share of a window reused by the next, 0 to <1
+  uint32_t hop = 0;      // frames between spectra, overrides overlap if set
+  WindowType window = WindowType::kRectangular;
+  float kaiser_beta = 8.6f;
+  ChannelMode channel_mode = ChannelMode::kMono; // kMidSide needs stereo
+  // transform length: kFast or kPowerOfTwo zero-pad the hz_gap window, the
+  // bins then lie closer than hz_gap (see GetFreqRange)
+  FftSize fft_size = FftSize::kExact;
+  SpectrumScale scale = SpectrumScale::kMagnitude; // what amplitudes hold
+  // publish band values instead of fft bins: amplitudes then hold a sine's
+  // level in its band whatever the window, GetFreqRange the band centres
+  BandScale bands = BandScale::kNone;
+  uint32_t mel_bands = 40; // for BandScale::kMel
+  // log spaced bins instead of hz_gap ones, exclusive with bands. The fft
+  // length follows from min_hz (ConstantQ::FftLen), the window is always
+  // rectangular as the kernels carry their own.
+  std::optional<ConstantQConfig> constant_q;
+  // averaging, attack / release and peak hold of what is published, for
+  // readers that render it as is. The defaults keep raw spectra.
+  SmoothingConfig smoothing;
+  // more window lengths over the same captured history, each on its own
+  // hop and published on its own: AcquireAmplitude(r) for r >= 1, r - 1
+  // indexing this. They take channel_mode, none of bands, constant_q or
+  // smoothing.
+  std::vector<ResolutionConfig> resolutions;
+  // Capture on one thread, analysis on another: the capture thread only
+  // copies packets into the pipeline's blocks, so no analysis cost can
+  // delay the device. Without it one thread does both.
+  std::optional<PipelineConfig> pipeline;
+  // Analyse as a stream of this pool, shared by many AudioThreads, rather
+  // than on a worker thread of our own. Implies a pipeline (the default
+  // PipelineConfig if none is set); the pool must outlive the AudioThread.
+  TaskPool *pool = nullptr;
+  StreamHints pool_hints;
+};
+
+// One analysis window: its spectrum and the raw samples that led to it.
+struct AudioFrame {
+  uint64_t seq;        // 1 for the first window, gaps mean dropped frames
+                       // or, with a pipeline, audio lost before the window
+  uint64_t sample_pos; // frames captured up to the end of this window
+  std::vector<float> amplitude; // spectrum s at s * amplitude_len
+  std::vector<float> raws; // planar, channel c at c * raw_len, oldest first
+};
+
+// Newest spectrum as seen by AcquireAmplitude.
+struct SpectrumView {
+  const float *data;   // spectrum s at data + s * len
+  const float *peak;   // held peaks, same layout, nullptr without
+                       // SmoothingConfig::peaks
+  uint32_t len;
+  uint32_t count;      // spectra, see AudioThread::GetSpectrumCount
+  uint64_t frame_id;   // AudioFrame::seq of the window, 0 before the first
+  uint64_t sample_pos; // frames captured up to the end of the window
+  std::chrono::steady_clock::time_point timestamp; // when it was published
+};
+
+// Newest window's raw samples as seen by AcquireRaw.
+struct RawView {
+  const float *data; // planar, channel c at data + c * len, oldest first
+  uint32_t len;
+  uint16_t channels;
+  uint64_t frame_id;   // SpectrumView::frame_id of the same window
+  uint64_t sample_pos; // frames captured up to the end of the window
+};
+
 class AudioThread {
+  static constexpr uint32_t kFrameQueueLen = 16;
+  static constexpr uint32_t kConvertFrames = 512; // per conversion chunk
+  static constexpr uint32_t kBlocksPerJob = 8; // then the pool runs others
+
 public:
+#ifdef _WIN32
+  // capture the default render device in loopback
   AudioThread(uint32_t hz_gap);
+#endif
+  // analyse frames from `source`, takes ownership of it. Any SampleType but
+  // kUnsupported is accepted, non float32 packets are converted on the way.
+  // Throws std::runtime_error for a config the source cannot run, with
+  // nothing allocated and `source` deleted.
+  AudioThread(uint32_t hz_gap, AudioSource *source);
+  AudioThread(const AnalysisConfig &config, AudioSource *source);
   ~AudioThread();
+  // Start, Pause, Resume, Stop and FlushLog belong to one control thread.
+  // Pause takes effect between packets: the capture thread leaves the
+  // source's packet loop and parks until Resume or Stop.
   void Start();
   void Pause();
   void Resume();
   void Stop();
+  // true once a finite source ran dry and the capture thread returned
+  bool IsFinished();
+  // Print what the capture thread logged since the last call; Stop does
+  // too. The capture thread itself never formats, locks or allocates.
+  void FlushLog(std::ostream &os = std::cout);
 
   uint16_t GetChannels();
+  // bins, or bands / constant-Q bins when AnalysisConfig asks for them
   uint32_t GetAmplitudeLen();
+  // 1 for ChannelMode::kMono, the channel count for kPerChannel, 2 (mid,
+  // side) for kMidSide
+  uint32_t GetSpectrumCount();
   uint32_t GetRawLen();
 
-  void GetAmplitude(float *dst);
+  // Zero-copy view of the newest spectrum, valid until the next call. Cheap
+  // enough to poll every render frame, check frame_id to skip repaints.
+  // AcquireAmplitude and GetAmplitude must be called from one thread.
+  SpectrumView AcquireAmplitude();
+  void GetAmplitude(float *dst); // spectrum 0
+  void GetAmplitude(float *dst, uint16_t channel);
   void GetFreqRange(float *dst);
+
+  // 1 + AnalysisConfig::resolutions, resolution 0 is the main analysis
+  // above. The others are fft bins, len in their views.
+  uint32_t GetResolutionCount();
+  SpectrumView AcquireAmplitude(uint32_t resolution);
+  void GetFreqRange(float *dst, uint32_t resolution);
+  // The newest window's raw samples, zeros before the first, valid until
+  // the next call; check frame_id to skip redraws. Copied out of the raw
+  // ring on the calling thread, only when a newer window was published,
+  // so capture pays nothing for it. GetRaw copies one channel of it.
+  // Leaves the ReadFrame queue alone; one thread only, which may be
+  // another than ReadFrame's.
+  RawView AcquireRaw();
   void GetRaw(float *dst, uint16_t c);
 
+  // Every completed frame in order, nullptr when none is queued. The frame
+  // stays valid until ReleaseFrame. Never blocks the capture thread, which
+  // drops frames (see GetDroppedFrames) rather than wait for a slow reader.
+  // ReadFrame and ReleaseFrame must be called from one thread.
+  const AudioFrame *ReadFrame();
+  void ReleaseFrame();
+  uint64_t GetDroppedFrames();
+  // all zero without AnalysisConfig::pipeline
+  PipelineStats GetPipelineStats();
+
 private:
+  enum class RunState : uint8_t {
+    kIdle,     // no capture thread
+    kRunning,  // in the source's packet loop
+    kPaused,   // parked on cv_, outside the packet loop
+    kStopping, // leaving Run
+  };
+
   void Run();
-  void ProcessBuffer(uint8_t *data, uint32_t frame_len);
+  void Analyse(); // the worker of AnalysisConfig::pipeline
+  void WakeAnalysis(); // capture side, after queueing blocks
+  static void AnalyseJob(void *self); // the same as an AnalysisConfig::pool job
+  // processes up to `max_blocks` queued blocks, true once none is left
+  bool Drain(uint32_t max_blocks = UINT32_MAX);
+  // frames the pipeline lost before the next block
+  void SkipLost(uint64_t frames);
+  void ProcessBuffer(const uint8_t *data, uint32_t frame_len);
+  void ProcessFrames(const float *data, uint32_t frame_len);
+  void PublishFrame();
+  void PublishResolution(uint32_t r);
   std::optional<std::thread> thread_;
-  std::atomic_bool stop_;
-  std::atomic_bool pause_;
-  std::condition_variable cv_;
+  std::optional<std::thread> worker_;
+  std::atomic_bool capture_done_; // Run returned, the worker drains
+  std::atomic<RunState> state_;
+  std::atomic_bool finished_;
+  std::condition_variable cv_; // wakes a kPaused capture thread
   std::mutex mutex_;
+  DeferredLog log_; // capture thread to FlushLog
+
+  std::unique_ptr<PacketPipeline> pipeline_; // null without ::pipeline
+  bool coalesce_;            // Backpressure::kCoalesce
+  bool coalescing_; // the worker has blocks waiting, transforms nothing
+  TaskPool *pool_;   // runs Drain instead of worker_ when set
+  StreamHints pool_hints_;
+  TaskPool::StreamId stream_; // registered from Start to Stop
+  WakeWord analyse_wake_;     // worker_ sleeps on it without a pool
 
-  AudioStream *audio_stream_;
-  AudioFFT *audio_fft_;
+  std::unique_ptr<AudioSource> audio_source_;
+  std::unique_ptr<MultiResolutionFFT> audio_fft_; // resolution 0 and config's
+  std::vector<float *> fft_dst_;  // where each resolution writes next
 
-#ifdef DEBUG
+#if defined(DEBUG) && defined(_WIN32)
   // for wav writing purpose
   WaveWriter w_writer_;
   uint32_t total_frame_len_ = 0;
 #endif
 
-  float *amplitude_;
+  struct Spectrum {
+    std::vector<float> amplitude;
+    std::vector<float> peak; // empty without SmoothingConfig::peaks
+    uint64_t frame_id;
+    uint64_t sample_pos;
+    std::chrono::steady_clock::time_point timestamp;
+  };
+  std::unique_ptr<TripleBuffer<Spectrum>> spectrum_;
   uint32_t amplitude_len_;
+  uint32_t spectrum_count_;
+  // r >= 1 at r - 1
+  std::vector<std::unique_ptr<TripleBuffer<Spectrum>>> resolutions_;
+  std::vector<uint64_t> resolution_seq_;
 
-  float **raws_;
+  std::unique_ptr<BandMapper> band_mapper_; // null without ::bands
+  std::vector<float> bins_;   // power spectra for band_mapper_
+  float band_gain_;           // 1 / the window's noise bandwidth
+  std::unique_ptr<ConstantQ> constant_q_; // null without ::constant_q
+  SpectrumScale mapped_scale_; // what either of them converts to
+  // null when AnalysisConfig::smoothing is all defaults
+  std::unique_ptr<SpectrumSmoother> smoother_;
+
+  // the last raw_len_ frames of each channel and one hop more, so the
+  // published window stays in place until the next one is
+  std::unique_ptr<PlanarRing> raws_;
   uint32_t raw_len_;
-  uint32_t raw_ptr_;
+  // AcquireRaw's sequence lock on the published window: even while it is
+  // at raw_pos_ in raws_, odd from before capture would write into it (a
+  // hop skipped, a gap) until PublishFrame hands over the next one
+  std::atomic<uint64_t> raw_seq_;
+  std::atomic<uint32_t> raw_pos_;
+  std::atomic<uint64_t> raw_frame_id_;
+  std::atomic<uint64_t> raw_sample_pos_;
+  uint32_t raw_free_; // capture side, frames writable before it is touched
+  void InvalidateRaw();
+  struct RawCopy {
+    std::vector<float> raws; // planar, channel c at c * raw_len_
+    uint64_t frame_id;
+    uint64_t sample_pos;
+    uint64_t seq; // raw_seq_ it was copied at
+  };
+  RawCopy raw_copy_;         // reader side, what AcquireRaw returns
+  std::vector<float> raw_scratch_; // reader side, raw_copy_ in the making
+  ConvertFn convert_;            // nullptr when packets are float32
+  std::vector<float> converted_; // kConvertFrames frames for convert_
+
+  std::unique_ptr<SpscRing<AudioFrame>> frames_;
+  uint64_t frame_seq_;
+  uint64_t sample_pos_;
+  std::atomic<uint64_t> dropped_frames_;
 };
 
 #endif
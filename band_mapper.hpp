@@ -0,0 +1,173 @@
+#ifndef BAND_MAPPER_HPP
+#define BAND_MAPPER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "dsp_kernels.h" // SpectrumScale, GetDecibels
+
+// Perceptual band layouts for BandMapper.
+enum class BandScale {
+  kNone,        // linear fft bins, no mapping
+  kThirdOctave, // IEC 61260 base-10 centres 1000 * 10^(k/10), 20 Hz and up
+  kMel,         // triangular filters evenly spaced on the HTK mel scale
+  kBark,        // Zwicker's 24 critical bands, rectangular
+};
+
+// Sums spectrum bins into bands. The weights are computed once from the
+// bin frequencies (AudioFFT::GetFreqRange). Every band covers one run of
+// adjacent bins, so a band is a first bin and a dense run of weights, and
+// Apply is one short dot product per band over memory it reads in order.
+// Rectangular bands weigh a bin by how much of it lies inside the band, and
+// triangular mel filters overlap by half. Either way, the weights of one
+// bin add up to 1 inside the covered range, so total energy is preserved.
+class BandMapper {
+  struct Row {
+    uint32_t first_bin; // first bin of the band
+    uint32_t offset;    // its weights in weights_
+    uint32_t len;       // bins in the band
+  };
+
+public:
+  // `freqs` holds `bins` evenly spaced bin frequencies starting at 0 Hz.
+  // `mel_bands` is only used by kMel.
+  BandMapper(BandScale scale, const float *freqs, uint32_t bins,
+             uint32_t mel_bands = 40)
+      : decibels_(GetDecibels()) {
+    const float gap = bins > 1 ? freqs[1] - freqs[0] : 1.0f;
+    const float nyquist = freqs[bins - 1];
+    switch (scale) {
+    case BandScale::kThirdOctave: {
+      const float half = std::pow(10.0f, 0.05f); // half a third of an octave
+      for (int k = -17; k <= 13; k++) {          // 20 Hz to 20 kHz
+        float centre = 1000.0f * std::pow(10.0f, k / 10.0f);
+        if (centre * half > nyquist) {
+          break;
+        }
+        this->AddRectangle(centre / half, centre * half, centre, gap, bins);
+      }
+      break;
+    }
+    case BandScale::kBark: {
+      static const float edges[] = {
+          0,    100,  200,  300,  400,  510,  630,  770,  920,
+          1080, 1270, 1480, 1720, 2000, 2320, 2700, 3150, 3700,
+          4400, 5300, 6400, 7700, 9500, 12000, 15500};
+      for (size_t b = 0; b + 1 < sizeof(edges) / sizeof(edges[0]); b++) {
+        if (edges[b] >= nyquist) {
+          break;
+        }
+        float hi = std::min(edges[b + 1], nyquist);
+        this->AddRectangle(edges[b], hi, (edges[b] + hi) / 2, gap, bins);
+      }
+      break;
+    }
+    case BandScale::kMel: {
+      auto to_mel = [](float f) { return 2595.0f * std::log10(1 + f / 700); };
+      auto to_hz = [](float m) {
+        return 700.0f * (std::pow(10.0f, m / 2595.0f) - 1);
+      };
+      const float top = to_mel(nyquist);
+      for (uint32_t b = 0; b < mel_bands; b++) {
+        float lo = to_hz(top * b / (mel_bands + 1));
+        float centre = to_hz(top * (b + 1) / (mel_bands + 1));
+        float hi = to_hz(top * (b + 2) / (mel_bands + 1));
+        this->AddTriangle(lo, centre, hi, gap, bins);
+      }
+      break;
+    }
+    case BandScale::kNone:
+      break;
+    }
+  }
+
+  uint32_t GetBandCount() const { return uint32_t(rows_.size()); }
+  // centre frequency of every band, where the GetFreqRange of bins would be
+  void GetCenters(float *dst) const {
+    std::copy(centres_.begin(), centres_.end(), dst);
+  }
+  // number of weights Apply multiplies, against bins * bands for a dense map
+  size_t GetWeightCount() const { return weights_.size(); }
+
+  // bands[b] = sum of weight * power[bin] over the band, times `gain`, then
+  // to `scale`. Feed it power spectra: bands hold energies, and with gain
+  // 1 / noise bandwidth a sine reads its amplitude squared. The magnitude
+  // and dB scales take the square root (or 10 log10, the SIMD kernel of
+  // SpectrumScale::kDecibels) of that.
+  void Apply(const float *power, float *bands, float gain = 1.0f,
+             SpectrumScale scale = SpectrumScale::kPower) const {
+    for (size_t b = 0; b < rows_.size(); b++) {
+      const Row &row = rows_[b];
+      const float *w = weights_.data() + row.offset;
+      const float *p = power + row.first_bin;
+      float sum = 0.0f;
+      for (uint32_t i = 0; i < row.len; i++) {
+        sum += w[i] * p[i];
+      }
+      bands[b] = sum * gain;
+    }
+    if (scale == SpectrumScale::kMagnitude) {
+      for (size_t b = 0; b < rows_.size(); b++) {
+        bands[b] = std::sqrt(bands[b]);
+      }
+    } else if (scale == SpectrumScale::kDecibels) {
+      decibels_(bands, bands, uint32_t(rows_.size()));
+    }
+  }
+
+private:
+  // bin k covers [(k - 1/2) gap, (k + 1/2) gap), weighed by its overlap
+  // with [lo, hi)
+  void AddRectangle(float lo, float hi, float centre, float gap,
+                    uint32_t bins) {
+    Row row{0, uint32_t(weights_.size()), 0};
+    for (uint32_t k = 0; k < bins; k++) {
+      float overlap = std::min(hi, (k + 0.5f) * gap) -
+                      std::max(lo, (k - 0.5f) * gap);
+      if (overlap <= 0.0f) {
+        if (row.len > 0) {
+          break;
+        }
+        continue;
+      }
+      if (row.len == 0) {
+        row.first_bin = k;
+      }
+      weights_.push_back(overlap / gap);
+      row.len++;
+    }
+    rows_.push_back(row);
+    centres_.push_back(centre);
+  }
+
+  // 1 at `centre` falling to 0 at `lo` and `hi`, sampled at the bins; low
+  // mel bands narrower than a bin may catch none
+  void AddTriangle(float lo, float centre, float hi, float gap,
+                   uint32_t bins) {
+    Row row{0, uint32_t(weights_.size()), 0};
+    for (uint32_t k = uint32_t(std::ceil(lo / gap)); k < bins; k++) {
+      float f = k * gap;
+      if (f >= hi) {
+        break;
+      }
+      float w =
+          f < centre ? (f - lo) / (centre - lo) : (hi - f) / (hi - centre);
+      if (row.len == 0) {
+        row.first_bin = k;
+      }
+      weights_.push_back(std::max(w, 0.0f));
+      row.len++;
+    }
+    rows_.push_back(row);
+    centres_.push_back(centre);
+  }
+
+  std::vector<Row> rows_;
+  std::vector<float> weights_; // every band's run, back to back
+  std::vector<float> centres_;
+  DecibelsFn decibels_;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef BLOCK_POOL_HPP
+#define BLOCK_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// A fixed number of equally sized blocks carved out of one allocation,
+// each starting on a cache line (kAlign) so no two blocks share one.
+// Blocks go around by Handle, an index, and Data turns a handle into
+// memory. The free list is a stack linked through the handles whose head
+// carries a counter bumped by every pop and push: a pop that read a head
+// which was popped and pushed back meanwhile (ABA) fails its compare and
+// swap instead of installing a stale next. Acquire and Release are lock
+// and allocation free from any number of threads, so the footprint is
+// whatever the constructor allocated, however long it runs.
+class BlockPool {
+public:
+  using Handle = uint32_t;
+  static constexpr Handle kNoBlock = UINT32_MAX;
+  static constexpr size_t kAlign = 64;
+
+  BlockPool(size_t block_bytes, uint32_t count)
+      : block_bytes_(block_bytes),
+        stride_((block_bytes + kAlign - 1) / kAlign * kAlign),
+        count_(count), next_(count), head_(Pack(0, count ? 0 : kNoBlock)),
+        available_(count) {
+    data_ = static_cast<uint8_t *>(::operator new(
+        stride_ * count + (count == 0), std::align_val_t(kAlign)));
+    for (Handle h = 0; h < count; h++) {
+      next_[h].store(h + 1 < count ? h + 1 : kNoBlock,
+                     std::memory_order_relaxed);
+    }
+  }
+  ~BlockPool() { ::operator delete(data_, std::align_val_t(kAlign)); }
+  BlockPool(const BlockPool &) = delete;
+  BlockPool &operator=(const BlockPool &) = delete;
+
+  size_t GetBlockBytes() const { return block_bytes_; }
+  uint32_t GetCount() const { return count_; }
+  // free blocks, approximate while others acquire or release
+  uint32_t Available() const {
+    return available_.load(std::memory_order_relaxed);
+  }
+
+  // false when every block is out
+  bool Acquire(Handle &h) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (Index(head) != kNoBlock) {
+      Handle next = next_[Index(head)].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, Pack(Tag(head) + 1, next),
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        h = Index(head);
+        available_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+  void Release(Handle h) {
+    available_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+      next_[h].store(Index(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, Pack(Tag(head) + 1, h),
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  uint8_t *Data(Handle h) const { return data_ + stride_ * h; }
+
+private:
+  static uint64_t Pack(uint32_t tag, Handle h) {
+    return uint64_t(tag) << 32 | h;
+  }
+  static uint32_t Tag(uint64_t head) { return uint32_t(head >> 32); }
+  static Handle Index(uint64_t head) { return Handle(head); }
+
+  size_t block_bytes_;
+  size_t stride_; // block_bytes_ rounded up to kAlign
+  uint32_t count_;
+  uint8_t *data_;
+  std::vector<std::atomic<Handle>> next_; // of each free block
+  alignas(64) std::atomic<uint64_t> head_; // tag << 32 | top handle
+  std::atomic<uint32_t> available_;
+};
+
+#endif
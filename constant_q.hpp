@@ -0,0 +1,162 @@
+#ifndef CONSTANT_Q_HPP
+#define CONSTANT_Q_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "dsp_kernels.h" // SpectrumScale
+#include "fft_plan.hpp"
+
+// Log spaced analysis bins, see ConstantQ.
+struct ConstantQConfig {
+  float min_hz = 55.0f;          // centre of the lowest bin
+  float max_hz = 0.0f;           // highest centre, 0 for up to nyquist
+  uint32_t bins_per_octave = 12; // semitones by default
+  // spectral kernel values under this share of the kernel's peak are
+  // dropped: higher is sparser and faster, lower is more exact
+  float threshold = 0.01f;
+};
+
+// Constant-Q transform on top of a real fft (Brown and Puckette, "An
+// efficient algorithm for the calculation of a constant Q transform",
+// 1992). Bin k is centred on min_hz * 2^(k / bins_per_octave) and its
+// temporal kernel is a Hamming windowed complex sine of Q cycles, Q =
+// 1 / (2^(1 / bins_per_octave) - 1): long at the bottom, short at the top.
+// The kernels' spectra are computed once and thresholded into a sparse
+// matrix, so a hop costs one fft of FftLen() plus a few weights per bin.
+// Every kernel ends at the newest sample: high bins react without waiting
+// for the length of the low ones. A sine centred on a bin reads its
+// amplitude there. Throws std::runtime_error for a config without bins:
+// no bins per octave, min_hz <= 0, or max_hz past nyquist.
+class ConstantQ {
+public:
+  ConstantQ(const ConstantQConfig &config, uint32_t sample_rate)
+      : nfft_(FftLen(config, sample_rate)) {
+    const double pi = 3.14159265358979323846;
+    const double q = 1.0 / (std::pow(2.0, 1.0 / config.bins_per_octave) - 1);
+    const double nyquist = sample_rate / 2.0;
+    const double top = config.max_hz > 0 ? config.max_hz : nyquist;
+
+    auto plan = GetFftPlan(FftLayout::kComplex, nfft_);
+    std::vector<kiss_fft_cpx> temporal(nfft_), spectral(nfft_),
+        scratch(plan->GetScratchLen());
+    rows_.push_back(0);
+    for (uint32_t k = 0;; k++) {
+      double centre =
+          config.min_hz * std::pow(2.0, double(k) / config.bins_per_octave);
+      // the bin's upper half must stay below nyquist
+      if (centre > top ||
+          centre * std::pow(2.0, 0.5 / config.bins_per_octave) > nyquist) {
+        break;
+      }
+      uint32_t len = std::min(
+          nfft_, uint32_t(std::ceil(q * sample_rate / centre)));
+      // scaled by 2 / sum(w) a real sine of amplitude a correlates to a
+      double sum = 0.0;
+      for (uint32_t n = 0; n < len; n++) {
+        sum += 0.54 - 0.46 * std::cos(2 * pi * n / len);
+      }
+      std::fill(temporal.begin(), temporal.end(), kiss_fft_cpx{0, 0});
+      for (uint32_t n = 0; n < len; n++) {
+        double w = (0.54 - 0.46 * std::cos(2 * pi * n / len)) * 2 / sum;
+        double phase = 2 * pi * centre * n / sample_rate;
+        temporal[nfft_ - len + n].r = float(w * std::cos(phase));
+        temporal[nfft_ - len + n].i = float(w * std::sin(phase));
+      }
+      kiss_fft_scratch(plan->Complex(), temporal.data(), spectral.data(),
+                       scratch.data());
+
+      // Parseval: sum x[n] conj(t[n]) = sum X[j] conj(T[j]) / nfft, over
+      // the positive frequencies where an analytic kernel lives
+      float peak = 0.0f;
+      for (uint32_t j = 0; j <= nfft_ / 2; j++) {
+        peak = std::max(peak, std::hypot(spectral[j].r, spectral[j].i));
+      }
+      for (uint32_t j = 0; j <= nfft_ / 2; j++) {
+        if (std::hypot(spectral[j].r, spectral[j].i) >=
+            config.threshold * peak) {
+          cols_.push_back(j);
+          kernel_re_.push_back(spectral[j].r / nfft_);
+          kernel_im_.push_back(-spectral[j].i / nfft_);
+        }
+      }
+      rows_.push_back(uint32_t(cols_.size()));
+      centres_.push_back(float(centre));
+    }
+  }
+
+  // Power of two fft length the longest (lowest) kernel fits in, the
+  // window AudioFFT must run for this ConstantQ; throws as the constructor
+  static uint32_t FftLen(const ConstantQConfig &config, uint32_t sample_rate) {
+    Check(config, sample_rate);
+    double q = 1.0 / (std::pow(2.0, 1.0 / config.bins_per_octave) - 1);
+    uint32_t len = uint32_t(std::ceil(q * sample_rate / config.min_hz));
+    uint32_t n = 2;
+    while (n < len) {
+      n *= 2;
+    }
+    return n;
+  }
+
+  uint32_t GetFftLen() const { return nfft_; }
+  uint32_t GetBinCount() const { return uint32_t(centres_.size()); }
+  void GetCenters(float *dst) const {
+    std::copy(centres_.begin(), centres_.end(), dst);
+  }
+  // kept kernel values, against bins * (nfft / 2 + 1) for a dense matrix
+  size_t GetWeightCount() const { return cols_.size(); }
+
+  // dst[k] = the bin's amplitude (squared, or in dB per `scale`) from the
+  // split complex output of an unwindowed, unscaled GetFftLen() point real
+  // fft, AudioFFT::GetBinsRe / GetBinsIm
+  void Apply(const float *re, const float *im, float *dst,
+             SpectrumScale scale = SpectrumScale::kMagnitude) const {
+    for (size_t k = 0; k + 1 < rows_.size(); k++) {
+      float acc_re = 0.0f, acc_im = 0.0f;
+      for (uint32_t i = rows_[k]; i < rows_[k + 1]; i++) {
+        const uint32_t j = cols_[i];
+        // X[j] times the conjugated kernel, stored conjugated
+        acc_re += re[j] * kernel_re_[i] - im[j] * kernel_im_[i];
+        acc_im += re[j] * kernel_im_[i] + im[j] * kernel_re_[i];
+      }
+      float power = acc_re * acc_re + acc_im * acc_im;
+      switch (scale) {
+      case SpectrumScale::kPower:
+        dst[k] = power;
+        break;
+      case SpectrumScale::kDecibels:
+        dst[k] = std::max(10 * std::log10(power), kDecibelFloor);
+        break;
+      default:
+        dst[k] = std::sqrt(power);
+        break;
+      }
+    }
+  }
+
+private:
+  static void Check(const ConstantQConfig &config, uint32_t sample_rate) {
+    if (config.bins_per_octave == 0) {
+      throw std::runtime_error("Constant-Q needs bins per octave");
+    }
+    if (!(config.min_hz > 0.0f)) {
+      throw std::runtime_error("Constant-Q min_hz must be above 0");
+    }
+    if (config.max_hz > sample_rate / 2.0) {
+      throw std::runtime_error("Constant-Q max_hz is past nyquist");
+    }
+  }
+
+  uint32_t nfft_;
+  // CSR: bin k's kernel values are [rows_[k], rows_[k + 1]) of the rest
+  std::vector<uint32_t> rows_;
+  std::vector<uint32_t> cols_; // fft bin of each value
+  std::vector<float> kernel_re_;
+  std::vector<float> kernel_im_;
+  std::vector<float> centres_;
+};
+
+#endif
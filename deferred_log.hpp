@@ -0,0 +1,62 @@
+#ifndef DEFERRED_LOG_HPP
+#define DEFERRED_LOG_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+#include "spsc_ring.hpp"
+
+// Log lines of a real-time thread. Push only stores a pointer to a static
+// message and a number in an SpscRing: no formatting, no allocation, no
+// lock, no stream. Another thread prints them later with Flush. A full
+// ring drops the line and counts it rather than wait.
+class DeferredLog {
+public:
+  struct Entry {
+    const char *message; // string literal, or anything living as long
+    uint64_t value;
+    bool has_value;
+  };
+
+  explicit DeferredLog(size_t capacity = 64)
+      : ring_(capacity, Entry{"", 0, false}), dropped_(0) {}
+
+  // producer side, the real-time thread
+  void Push(const char *message) { this->Push(message, 0, false); }
+  void Push(const char *message, uint64_t value) {
+    this->Push(message, value, true);
+  }
+
+  // consumer side: prints every queued line, then how many were dropped
+  void Flush(std::ostream &os) {
+    while (const Entry *entry = ring_.Front()) {
+      os << entry->message;
+      if (entry->has_value) {
+        os << entry->value;
+      }
+      os << '\n';
+      ring_.Pop();
+    }
+    uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+      os << "(" << dropped << " log lines dropped)\n";
+    }
+  }
+
+private:
+  void Push(const char *message, uint64_t value, bool has_value) {
+    Entry *entry = ring_.BeginPush();
+    if (entry == nullptr) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    *entry = {message, value, has_value};
+    ring_.CommitPush();
+  }
+
+  SpscRing<Entry> ring_;
+  std::atomic<uint64_t> dropped_;
+};
+
+#endif
@@ -0,0 +1,994 @@
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KERNEL_SSE2
+#define KERNEL_AVX2
+#else
+#define KERNEL_SSE2 __attribute__((target("sse2")))
+#define KERNEL_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define KERNELS_X86 0
+#endif
+
+namespace {
+
+// Frames [begin, frames) one at a time, also the tail of every SIMD kernel.
+// C == 0 means the channel count is only known at runtime.
+template <int C, bool kPlanar>
+inline void DeinterleaveTail(const float *src, uint32_t begin, uint32_t frames,
+                             uint16_t channels, float *const *planar,
+                             float *mono) {
+  const int ch = C > 0 ? C : channels;
+  const float inv = 1.0f / ch;
+  for (uint32_t i = begin; i < frames; i++) {
+    const float *frame = src + (size_t)i * ch;
+    float sum = 0.0f;
+    for (int c = 0; c < ch; c++) {
+      sum += frame[c];
+      if (kPlanar) {
+        planar[c][i] = frame[c];
+      }
+    }
+    mono[i] = sum * inv;
+  }
+}
+
+template <int C>
+void DeinterleaveScalar(const float *src, uint32_t frames, uint16_t channels,
+                        float *const *planar, float *mono) {
+  if (planar) {
+    DeinterleaveTail<C, true>(src, 0, frames, channels, planar, mono);
+  } else {
+    DeinterleaveTail<C, false>(src, 0, frames, channels, planar, mono);
+  }
+}
+
+void MulWindowScalar(const float *src, const float *w, float *dst,
+                     uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    dst[i] = src[i] * w[i];
+  }
+}
+
+void MagnitudeScalar(const float *re, const float *im, float scale,
+                     float *dst, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    dst[i] = std::sqrt(re[i] * re[i] + im[i] * im[i]) * scale;
+  }
+}
+
+void PowerScalar(const float *re, const float *im, float scale, float *dst,
+                 uint32_t len) {
+  const float s2 = scale * scale;
+  for (uint32_t i = 0; i < len; i++) {
+    dst[i] = (re[i] * re[i] + im[i] * im[i]) * s2;
+  }
+}
+
+// FastLog2 constants: 2 / ln 2 / (2k + 1), the atanh series of ln(m)
+constexpr float kLog2C1 = 2.8853900817779268f;
+constexpr float kLog2C3 = 0.9617966939259756f;
+constexpr float kLog2C5 = 0.5770780163555854f;
+constexpr float kLog2C7 = 0.4121985831111324f;
+constexpr float kSqrt2 = 1.4142135623730951f;
+constexpr float kDbPerLog2 = 3.0102999566398120f; // 10 log10(2)
+// keeps log2 off zero and denormals, a little under kDecibelFloor so that
+// the final max lands exactly on it
+constexpr float kPowerFloor = 5e-13f;
+
+// log2 of a normal x > 0: x = m 2^e with m in [sqrt(1/2), sqrt(2)), then
+// log2(m) = 2 / ln 2 atanh(t), t = (m - 1) / (m + 1), to t^7. |t| < 0.172
+// keeps the series error under 2e-7, about float rounding. The SIMD
+// versions repeat these operations in this order, for identical results.
+inline float FastLog2(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  int32_t e = int32_t(bits >> 23) - 127;
+  bits = (bits & 0x007FFFFF) | 0x3F800000;
+  float m;
+  std::memcpy(&m, &bits, sizeof(m));
+  if (m > kSqrt2) {
+    m *= 0.5f;
+    e += 1;
+  }
+  float t = (m - 1.0f) / (m + 1.0f), t2 = t * t;
+  float poly = t * (kLog2C1 + t2 * (kLog2C3 + t2 * (kLog2C5 + t2 * kLog2C7)));
+  return (float)e + poly;
+}
+
+void DecibelsScalar(const float *re, const float *im, float scale, float *dst,
+                    uint32_t len) {
+  const float s2 = scale * scale;
+  for (uint32_t i = 0; i < len; i++) {
+    float power = std::max((re[i] * re[i] + im[i] * im[i]) * s2, kPowerFloor);
+    dst[i] = std::max(FastLog2(power) * kDbPerLog2, kDecibelFloor);
+  }
+}
+
+void PowerDecibelsScalar(const float *power, float *dst, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    float p = std::max(power[i], kPowerFloor);
+    dst[i] = std::max(FastLog2(p) * kDbPerLog2, kDecibelFloor);
+  }
+}
+
+// One sample of each SampleType, decoded. Integers are scaled by a power of
+// two after an exact or round-to-nearest int to float conversion, which the
+// SIMD versions below reproduce bit for bit.
+template <SampleType T> struct Sample;
+
+template <> struct Sample<SampleType::kFloat32> {
+  static constexpr int kBytes = 4;
+  static float Load(const uint8_t *p) {
+    float v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+};
+
+template <> struct Sample<SampleType::kFloat64> {
+  static constexpr int kBytes = 8;
+  static float Load(const uint8_t *p) {
+    double v;
+    std::memcpy(&v, p, sizeof(v));
+    return (float)v;
+  }
+};
+
+template <> struct Sample<SampleType::kInt16> {
+  static constexpr int kBytes = 2;
+  static float Load(const uint8_t *p) {
+    int16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v * (1.0f / 32768.0f);
+  }
+};
+
+// read into the top 24 bits of an int32, which also sign extends it
+template <> struct Sample<SampleType::kInt24> {
+  static constexpr int kBytes = 3;
+  static float Load(const uint8_t *p) {
+    int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                          (uint32_t)p[2] << 24);
+    return v * (1.0f / 2147483648.0f);
+  }
+};
+
+template <> struct Sample<SampleType::kInt32> {
+  static constexpr int kBytes = 4;
+  static float Load(const uint8_t *p) {
+    int32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v * (1.0f / 2147483648.0f);
+  }
+};
+
+// Bins [begin, len) one at a time, also the tail of the SIMD versions
+inline void SmoothTail(float *x, float *peaks, uint32_t begin, uint32_t len,
+                       const SmoothParams &p, const SmoothState &s) {
+  for (uint32_t i = begin; i < len; i++) {
+    float v = x[i];
+    if (s.sum) {
+      float sum = s.sum[i] + (v - s.oldest[i]);
+      s.sum[i] = sum;
+      s.oldest[i] = v;
+      v = sum * p.inv_frames;
+    }
+    if (s.level) {
+      float level = s.level[i];
+      float a = v > level ? p.attack : p.release;
+      level = level + a * (v - level);
+      s.level[i] = level;
+      v = level;
+    }
+    x[i] = v;
+    if (s.peak) {
+      float peak = s.peak[i], age = s.age[i] + 1.0f;
+      if (v >= peak) {
+        peak = v;
+        age = 0.0f;
+      } else if (age > p.hold) {
+        peak = std::max(peak - p.decay, v);
+      }
+      s.peak[i] = peak;
+      s.age[i] = age;
+      peaks[i] = peak;
+    }
+  }
+}
+
+void SmoothScalar(float *x, float *peaks, uint32_t len, const SmoothParams &p,
+                  const SmoothState &s) {
+  SmoothTail(x, peaks, 0, len, p, s);
+}
+
+template <SampleType T>
+void ConvertScalar(const uint8_t *src, uint32_t samples, float *dst) {
+  for (uint32_t i = 0; i < samples; i++) {
+    dst[i] = Sample<T>::Load(src + (size_t)i * Sample<T>::kBytes);
+  }
+}
+
+#if KERNELS_X86
+
+// ---- SSE2 ------------------------------------------------------------------
+
+template <bool kPlanar>
+KERNEL_SSE2 void Mono1Sse2(const float *src, uint32_t frames,
+                           float *const *planar, float *mono) {
+  uint32_t i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    __m128 v = _mm_loadu_ps(src + i);
+    if (kPlanar) {
+      _mm_storeu_ps(planar[0] + i, v);
+    }
+    _mm_storeu_ps(mono + i, v);
+  }
+  DeinterleaveTail<1, kPlanar>(src, i, frames, 1, planar, mono);
+}
+
+template <bool kPlanar>
+KERNEL_SSE2 void Stereo2Sse2(const float *src, uint32_t frames,
+                             float *const *planar, float *mono) {
+  const __m128 half = _mm_set1_ps(0.5f);
+  uint32_t i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    __m128 a = _mm_loadu_ps(src + 2 * i);     // L0 R0 L1 R1
+    __m128 b = _mm_loadu_ps(src + 2 * i + 4); // L2 R2 L3 R3
+    __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    if (kPlanar) {
+      _mm_storeu_ps(planar[0] + i, l);
+      _mm_storeu_ps(planar[1] + i, r);
+    }
+    _mm_storeu_ps(mono + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+  }
+  DeinterleaveTail<2, kPlanar>(src, i, frames, 2, planar, mono);
+}
+
+// 7.1: two 4x4 transposes per 4 frames
+template <bool kPlanar>
+KERNEL_SSE2 void Surround8Sse2(const float *src, uint32_t frames,
+                               float *const *planar, float *mono) {
+  const __m128 eighth = _mm_set1_ps(0.125f);
+  uint32_t i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    const float *f = src + 8 * (size_t)i;
+    __m128 sum = _mm_setzero_ps();
+    for (int half = 0; half < 2; half++) {
+      __m128 r0 = _mm_loadu_ps(f + 4 * half);
+      __m128 r1 = _mm_loadu_ps(f + 8 + 4 * half);
+      __m128 r2 = _mm_loadu_ps(f + 16 + 4 * half);
+      __m128 r3 = _mm_loadu_ps(f + 24 + 4 * half);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      if (kPlanar) {
+        _mm_storeu_ps(planar[4 * half + 0] + i, r0);
+        _mm_storeu_ps(planar[4 * half + 1] + i, r1);
+        _mm_storeu_ps(planar[4 * half + 2] + i, r2);
+        _mm_storeu_ps(planar[4 * half + 3] + i, r3);
+      }
+      sum = _mm_add_ps(sum, _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+    }
+    _mm_storeu_ps(mono + i, _mm_mul_ps(sum, eighth));
+  }
+  DeinterleaveTail<8, kPlanar>(src, i, frames, 8, planar, mono);
+}
+
+KERNEL_SSE2 void MulWindowSse2(const float *src, const float *w, float *dst,
+                               uint32_t len) {
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    _mm_storeu_ps(dst + i,
+                  _mm_mul_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(w + i)));
+  }
+  MulWindowScalar(src + i, w + i, dst + i, len - i);
+}
+
+KERNEL_SSE2 void MagnitudeSse2(const float *re, const float *im, float scale,
+                               float *dst, uint32_t len) {
+  const __m128 s = _mm_set1_ps(scale);
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 r = _mm_loadu_ps(re + i), m = _mm_loadu_ps(im + i);
+    __m128 power = _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_sqrt_ps(power), s));
+  }
+  MagnitudeScalar(re + i, im + i, scale, dst + i, len - i);
+}
+
+KERNEL_SSE2 void PowerSse2(const float *re, const float *im, float scale,
+                           float *dst, uint32_t len) {
+  const __m128 s2 = _mm_set1_ps(scale * scale);
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 r = _mm_loadu_ps(re + i), m = _mm_loadu_ps(im + i);
+    __m128 power = _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(power, s2));
+  }
+  PowerScalar(re + i, im + i, scale, dst + i, len - i);
+}
+
+// mask ? a : b
+KERNEL_SSE2 inline __m128 SelectSse2(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+KERNEL_SSE2 void SmoothSse2(float *x, float *peaks, uint32_t len,
+                            const SmoothParams &p, const SmoothState &s) {
+  const __m128 inv_frames = _mm_set1_ps(p.inv_frames);
+  const __m128 attack = _mm_set1_ps(p.attack), release = _mm_set1_ps(p.release);
+  const __m128 hold = _mm_set1_ps(p.hold), decay = _mm_set1_ps(p.decay);
+  const __m128 one = _mm_set1_ps(1.0f);
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 v = _mm_loadu_ps(x + i);
+    if (s.sum) {
+      __m128 sum = _mm_add_ps(_mm_loadu_ps(s.sum + i),
+                              _mm_sub_ps(v, _mm_loadu_ps(s.oldest + i)));
+      _mm_storeu_ps(s.sum + i, sum);
+      _mm_storeu_ps(s.oldest + i, v);
+      v = _mm_mul_ps(sum, inv_frames);
+    }
+    if (s.level) {
+      __m128 level = _mm_loadu_ps(s.level + i);
+      __m128 a = SelectSse2(_mm_cmpgt_ps(v, level), attack, release);
+      level = _mm_add_ps(level, _mm_mul_ps(a, _mm_sub_ps(v, level)));
+      _mm_storeu_ps(s.level + i, level);
+      v = level;
+    }
+    _mm_storeu_ps(x + i, v);
+    if (s.peak) {
+      __m128 peak = _mm_loadu_ps(s.peak + i);
+      __m128 age = _mm_add_ps(_mm_loadu_ps(s.age + i), one);
+      __m128 rise = _mm_cmpge_ps(v, peak);
+      __m128 decayed = _mm_max_ps(_mm_sub_ps(peak, decay), v);
+      peak = SelectSse2(_mm_cmpgt_ps(age, hold), decayed, peak);
+      peak = SelectSse2(rise, v, peak);
+      _mm_storeu_ps(s.peak + i, peak);
+      _mm_storeu_ps(s.age + i, _mm_andnot_ps(rise, age));
+      _mm_storeu_ps(peaks + i, peak);
+    }
+  }
+  SmoothTail(x, peaks, i, len, p, s);
+}
+
+// FastLog2, four at a time
+KERNEL_SSE2 __m128 FastLog2Sse2(__m128 x) {
+  __m128i bits = _mm_castps_si128(x);
+  __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+  __m128 m = _mm_castsi128_ps(
+      _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+                   _mm_set1_epi32(0x3F800000)));
+  __m128 above = _mm_cmpgt_ps(m, _mm_set1_ps(kSqrt2));
+  m = _mm_or_ps(_mm_and_ps(above, _mm_mul_ps(m, _mm_set1_ps(0.5f))),
+                _mm_andnot_ps(above, m));
+  e = _mm_sub_epi32(e, _mm_castps_si128(above)); // above is -1
+  const __m128 one = _mm_set1_ps(1.0f);
+  __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+  __m128 t2 = _mm_mul_ps(t, t);
+  __m128 poly = _mm_add_ps(_mm_set1_ps(kLog2C5),
+                           _mm_mul_ps(t2, _mm_set1_ps(kLog2C7)));
+  poly = _mm_add_ps(_mm_set1_ps(kLog2C3), _mm_mul_ps(t2, poly));
+  poly = _mm_add_ps(_mm_set1_ps(kLog2C1), _mm_mul_ps(t2, poly));
+  return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(t, poly));
+}
+
+KERNEL_SSE2 void DecibelsSse2(const float *re, const float *im, float scale,
+                              float *dst, uint32_t len) {
+  const __m128 s2 = _mm_set1_ps(scale * scale);
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 r = _mm_loadu_ps(re + i), m = _mm_loadu_ps(im + i);
+    __m128 power = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m)),
+                              s2);
+    power = _mm_max_ps(power, _mm_set1_ps(kPowerFloor));
+    __m128 db = _mm_mul_ps(FastLog2Sse2(power), _mm_set1_ps(kDbPerLog2));
+    _mm_storeu_ps(dst + i, _mm_max_ps(db, _mm_set1_ps(kDecibelFloor)));
+  }
+  DecibelsScalar(re + i, im + i, scale, dst + i, len - i);
+}
+
+KERNEL_SSE2 void PowerDecibelsSse2(const float *power, float *dst,
+                                   uint32_t len) {
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 p = _mm_max_ps(_mm_loadu_ps(power + i), _mm_set1_ps(kPowerFloor));
+    __m128 db = _mm_mul_ps(FastLog2Sse2(p), _mm_set1_ps(kDbPerLog2));
+    _mm_storeu_ps(dst + i, _mm_max_ps(db, _mm_set1_ps(kDecibelFloor)));
+  }
+  PowerDecibelsScalar(power + i, dst + i, len - i);
+}
+
+KERNEL_SSE2 void Int16ToFloatSse2(const uint8_t *src, uint32_t samples,
+                                  float *dst) {
+  const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+  uint32_t i = 0;
+  for (; i + 8 <= samples; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * (size_t)i));
+    // each sample into the top half of a lane, shifted back down signed
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+  ConvertScalar<SampleType::kInt16>(src + 2 * (size_t)i, samples - i, dst + i);
+}
+
+KERNEL_SSE2 void Int32ToFloatSse2(const uint8_t *src, uint32_t samples,
+                                  float *dst) {
+  const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+  uint32_t i = 0;
+  for (; i + 4 <= samples; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * (size_t)i));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+  }
+  ConvertScalar<SampleType::kInt32>(src + 4 * (size_t)i, samples - i, dst + i);
+}
+
+KERNEL_SSE2 void Float64ToFloatSse2(const uint8_t *src, uint32_t samples,
+                                    float *dst) {
+  uint32_t i = 0;
+  for (; i + 4 <= samples; i += 4) {
+    const double *d = (const double *)(src + 8 * (size_t)i);
+    __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(d));
+    __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(d + 2));
+    _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+  }
+  ConvertScalar<SampleType::kFloat64>(src + 8 * (size_t)i, samples - i,
+                                      dst + i);
+}
+
+// ---- AVX2 ------------------------------------------------------------------
+
+template <bool kPlanar>
+KERNEL_AVX2 void Mono1Avx2(const float *src, uint32_t frames,
+                           float *const *planar, float *mono) {
+  uint32_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    __m256 v = _mm256_loadu_ps(src + i);
+    if (kPlanar) {
+      _mm256_storeu_ps(planar[0] + i, v);
+    }
+    _mm256_storeu_ps(mono + i, v);
+  }
+  DeinterleaveTail<1, kPlanar>(src, i, frames, 1, planar, mono);
+}
+
+template <bool kPlanar>
+KERNEL_AVX2 void Stereo2Avx2(const float *src, uint32_t frames,
+                             float *const *planar, float *mono) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+  uint32_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    __m256 a = _mm256_loadu_ps(src + 2 * i);     // L0 R0 L1 R1 | L2 R2 L3 R3
+    __m256 b = _mm256_loadu_ps(src + 2 * i + 8); // L4 R4 L5 R5 | L6 R6 L7 R7
+    // L0 L1 L4 L5 | L2 L3 L6 L7, then fix the 64 bit pair order
+    __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    l = _mm256_castpd_ps(
+        _mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+    r = _mm256_castpd_ps(
+        _mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+    if (kPlanar) {
+      _mm256_storeu_ps(planar[0] + i, l);
+      _mm256_storeu_ps(planar[1] + i, r);
+    }
+    _mm256_storeu_ps(mono + i, _mm256_mul_ps(_mm256_add_ps(l, r), half));
+  }
+  DeinterleaveTail<2, kPlanar>(src, i, frames, 2, planar, mono);
+}
+
+// 7.1: one 8x8 transpose per 8 frames
+template <bool kPlanar>
+KERNEL_AVX2 void Surround8Avx2(const float *src, uint32_t frames,
+                               float *const *planar, float *mono) {
+  const __m256 eighth = _mm256_set1_ps(0.125f);
+  uint32_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    const float *f = src + 8 * (size_t)i;
+    __m256 t0 = _mm256_unpacklo_ps(_mm256_loadu_ps(f), _mm256_loadu_ps(f + 8));
+    __m256 t1 = _mm256_unpackhi_ps(_mm256_loadu_ps(f), _mm256_loadu_ps(f + 8));
+    __m256 t2 =
+        _mm256_unpacklo_ps(_mm256_loadu_ps(f + 16), _mm256_loadu_ps(f + 24));
+    __m256 t3 =
+        _mm256_unpackhi_ps(_mm256_loadu_ps(f + 16), _mm256_loadu_ps(f + 24));
+    __m256 t4 =
+        _mm256_unpacklo_ps(_mm256_loadu_ps(f + 32), _mm256_loadu_ps(f + 40));
+    __m256 t5 =
+        _mm256_unpackhi_ps(_mm256_loadu_ps(f + 32), _mm256_loadu_ps(f + 40));
+    __m256 t6 =
+        _mm256_unpacklo_ps(_mm256_loadu_ps(f + 48), _mm256_loadu_ps(f + 56));
+    __m256 t7 =
+        _mm256_unpackhi_ps(_mm256_loadu_ps(f + 48), _mm256_loadu_ps(f + 56));
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 c[8] = {
+        _mm256_permute2f128_ps(s0, s4, 0x20),
+        _mm256_permute2f128_ps(s1, s5, 0x20),
+        _mm256_permute2f128_ps(s2, s6, 0x20),
+        _mm256_permute2f128_ps(s3, s7, 0x20),
+        _mm256_permute2f128_ps(s0, s4, 0x31),
+        _mm256_permute2f128_ps(s1, s5, 0x31),
+        _mm256_permute2f128_ps(s2, s6, 0x31),
+        _mm256_permute2f128_ps(s3, s7, 0x31),
+    };
+    if (kPlanar) {
+      for (int ch = 0; ch < 8; ch++) {
+        _mm256_storeu_ps(planar[ch] + i, c[ch]);
+      }
+    }
+    __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(c[0], c[1]),
+                                             _mm256_add_ps(c[2], c[3])),
+                               _mm256_add_ps(_mm256_add_ps(c[4], c[5]),
+                                             _mm256_add_ps(c[6], c[7])));
+    _mm256_storeu_ps(mono + i, _mm256_mul_ps(sum, eighth));
+  }
+  DeinterleaveTail<8, kPlanar>(src, i, frames, 8, planar, mono);
+}
+
+// 5.1 and any other layout: one gather per channel per 8 frames
+template <int C, bool kPlanar>
+KERNEL_AVX2 void GatherAvx2(const float *src, uint32_t frames,
+                            uint16_t channels, float *const *planar,
+                            float *mono) {
+  const int ch = C > 0 ? C : channels;
+  const __m256 inv = _mm256_set1_ps(1.0f / ch);
+  const __m256i idx = _mm256_mullo_epi32(
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(ch));
+  uint32_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    const float *f = src + (size_t)i * ch;
+    __m256 sum = _mm256_setzero_ps();
+    for (int c = 0; c < ch; c++) {
+      __m256 v = _mm256_i32gather_ps(f + c, idx, 4);
+      if (kPlanar) {
+        _mm256_storeu_ps(planar[c] + i, v);
+      }
+      sum = _mm256_add_ps(sum, v);
+    }
+    _mm256_storeu_ps(mono + i, _mm256_mul_ps(sum, inv));
+  }
+  DeinterleaveTail<C, kPlanar>(src, i, frames, channels, planar, mono);
+}
+
+KERNEL_AVX2 void MulWindowAvx2(const float *src, const float *w, float *dst,
+                               uint32_t len) {
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i),
+                                            _mm256_loadu_ps(w + i)));
+  }
+  MulWindowScalar(src + i, w + i, dst + i, len - i);
+}
+
+KERNEL_AVX2 void MagnitudeAvx2(const float *re, const float *im, float scale,
+                               float *dst, uint32_t len) {
+  const __m256 s = _mm256_set1_ps(scale);
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 r = _mm256_loadu_ps(re + i), m = _mm256_loadu_ps(im + i);
+    __m256 power = _mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(m, m));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_sqrt_ps(power), s));
+  }
+  MagnitudeScalar(re + i, im + i, scale, dst + i, len - i);
+}
+
+KERNEL_AVX2 void SmoothAvx2(float *x, float *peaks, uint32_t len,
+                            const SmoothParams &p, const SmoothState &s) {
+  const __m256 inv_frames = _mm256_set1_ps(p.inv_frames);
+  const __m256 attack = _mm256_set1_ps(p.attack);
+  const __m256 release = _mm256_set1_ps(p.release);
+  const __m256 hold = _mm256_set1_ps(p.hold), decay = _mm256_set1_ps(p.decay);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 v = _mm256_loadu_ps(x + i);
+    if (s.sum) {
+      __m256 sum = _mm256_add_ps(
+          _mm256_loadu_ps(s.sum + i),
+          _mm256_sub_ps(v, _mm256_loadu_ps(s.oldest + i)));
+      _mm256_storeu_ps(s.sum + i, sum);
+      _mm256_storeu_ps(s.oldest + i, v);
+      v = _mm256_mul_ps(sum, inv_frames);
+    }
+    if (s.level) {
+      __m256 level = _mm256_loadu_ps(s.level + i);
+      __m256 a = _mm256_blendv_ps(release, attack,
+                                  _mm256_cmp_ps(v, level, _CMP_GT_OQ));
+      level = _mm256_add_ps(level, _mm256_mul_ps(a, _mm256_sub_ps(v, level)));
+      _mm256_storeu_ps(s.level + i, level);
+      v = level;
+    }
+    _mm256_storeu_ps(x + i, v);
+    if (s.peak) {
+      __m256 peak = _mm256_loadu_ps(s.peak + i);
+      __m256 age = _mm256_add_ps(_mm256_loadu_ps(s.age + i), one);
+      __m256 rise = _mm256_cmp_ps(v, peak, _CMP_GE_OQ);
+      __m256 decayed = _mm256_max_ps(_mm256_sub_ps(peak, decay), v);
+      peak = _mm256_blendv_ps(peak, decayed,
+                              _mm256_cmp_ps(age, hold, _CMP_GT_OQ));
+      peak = _mm256_blendv_ps(peak, v, rise);
+      _mm256_storeu_ps(s.peak + i, peak);
+      _mm256_storeu_ps(s.age + i, _mm256_andnot_ps(rise, age));
+      _mm256_storeu_ps(peaks + i, peak);
+    }
+  }
+  SmoothTail(x, peaks, i, len, p, s);
+}
+
+KERNEL_AVX2 void PowerAvx2(const float *re, const float *im, float scale,
+                           float *dst, uint32_t len) {
+  const __m256 s2 = _mm256_set1_ps(scale * scale);
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 r = _mm256_loadu_ps(re + i), m = _mm256_loadu_ps(im + i);
+    __m256 power = _mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(m, m));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(power, s2));
+  }
+  PowerScalar(re + i, im + i, scale, dst + i, len - i);
+}
+
+// FastLog2, eight at a time
+KERNEL_AVX2 __m256 FastLog2Avx2(__m256 x) {
+  __m256i bits = _mm256_castps_si256(x);
+  __m256i e =
+      _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+  __m256 m = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+                      _mm256_set1_epi32(0x3F800000)));
+  __m256 above = _mm256_cmp_ps(m, _mm256_set1_ps(kSqrt2), _CMP_GT_OQ);
+  m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), above);
+  e = _mm256_sub_epi32(e, _mm256_castps_si256(above)); // above is -1
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+  __m256 t2 = _mm256_mul_ps(t, t);
+  __m256 poly = _mm256_add_ps(_mm256_set1_ps(kLog2C5),
+                              _mm256_mul_ps(t2, _mm256_set1_ps(kLog2C7)));
+  poly = _mm256_add_ps(_mm256_set1_ps(kLog2C3), _mm256_mul_ps(t2, poly));
+  poly = _mm256_add_ps(_mm256_set1_ps(kLog2C1), _mm256_mul_ps(t2, poly));
+  return _mm256_add_ps(_mm256_cvtepi32_ps(e), _mm256_mul_ps(t, poly));
+}
+
+KERNEL_AVX2 void DecibelsAvx2(const float *re, const float *im, float scale,
+                              float *dst, uint32_t len) {
+  const __m256 s2 = _mm256_set1_ps(scale * scale);
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 r = _mm256_loadu_ps(re + i), m = _mm256_loadu_ps(im + i);
+    __m256 power = _mm256_mul_ps(
+        _mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(m, m)), s2);
+    power = _mm256_max_ps(power, _mm256_set1_ps(kPowerFloor));
+    __m256 db =
+        _mm256_mul_ps(FastLog2Avx2(power), _mm256_set1_ps(kDbPerLog2));
+    _mm256_storeu_ps(dst + i, _mm256_max_ps(db, _mm256_set1_ps(kDecibelFloor)));
+  }
+  DecibelsScalar(re + i, im + i, scale, dst + i, len - i);
+}
+
+KERNEL_AVX2 void PowerDecibelsAvx2(const float *power, float *dst,
+                                   uint32_t len) {
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 p = _mm256_max_ps(_mm256_loadu_ps(power + i),
+                             _mm256_set1_ps(kPowerFloor));
+    __m256 db = _mm256_mul_ps(FastLog2Avx2(p), _mm256_set1_ps(kDbPerLog2));
+    _mm256_storeu_ps(dst + i, _mm256_max_ps(db, _mm256_set1_ps(kDecibelFloor)));
+  }
+  PowerDecibelsScalar(power + i, dst + i, len - i);
+}
+
+KERNEL_AVX2 void Int16ToFloatAvx2(const uint8_t *src, uint32_t samples,
+                                  float *dst) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+  uint32_t i = 0;
+  for (; i + 8 <= samples; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128((const __m128i *)(src + 2 * (size_t)i)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+  }
+  ConvertScalar<SampleType::kInt16>(src + 2 * (size_t)i, samples - i, dst + i);
+}
+
+// 8 samples are 24 bytes: bytes [0, 16) and [12, 28) go to the two lanes,
+// the shuffle puts each sample in the top 24 bits of an int32
+KERNEL_AVX2 void Int24ToFloatAvx2(const uint8_t *src, uint32_t samples,
+                                  float *dst) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+  const __m256i shuffle = _mm256_setr_epi8(
+      -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, //
+      -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  uint32_t i = 0;
+  // the second load reads 4 bytes past the 8th sample, stay 2 samples clear
+  for (; i + 10 <= samples; i += 8) {
+    const uint8_t *p = src + 3 * (size_t)i;
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+        _mm_loadu_si128((const __m128i *)(p + 12)), 1);
+    v = _mm256_shuffle_epi8(v, shuffle);
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+  }
+  ConvertScalar<SampleType::kInt24>(src + 3 * (size_t)i, samples - i, dst + i);
+}
+
+KERNEL_AVX2 void Int32ToFloatAvx2(const uint8_t *src, uint32_t samples,
+                                  float *dst) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+  uint32_t i = 0;
+  for (; i + 8 <= samples; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + 4 * (size_t)i));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+  }
+  ConvertScalar<SampleType::kInt32>(src + 4 * (size_t)i, samples - i, dst + i);
+}
+
+KERNEL_AVX2 void Float64ToFloatAvx2(const uint8_t *src, uint32_t samples,
+                                    float *dst) {
+  uint32_t i = 0;
+  for (; i + 8 <= samples; i += 8) {
+    const double *d = (const double *)(src + 8 * (size_t)i);
+    __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(d));
+    __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(d + 4));
+    _mm256_storeu_ps(dst + i,
+                     _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+  }
+  ConvertScalar<SampleType::kFloat64>(src + 8 * (size_t)i, samples - i,
+                                      dst + i);
+}
+
+// Resolve the planar/no planar choice once per call, not per frame.
+#define PLANAR_DISPATCH(name, kernel)                                          \
+  void name(const float *src, uint32_t frames, uint16_t, float *const *planar, \
+            float *mono) {                                                     \
+    if (planar) {                                                              \
+      kernel<true>(src, frames, planar, mono);                                 \
+    } else {                                                                   \
+      kernel<false>(src, frames, planar, mono);                                \
+    }                                                                          \
+  }
+
+PLANAR_DISPATCH(DeinterleaveMono1Sse2, Mono1Sse2)
+PLANAR_DISPATCH(DeinterleaveStereo2Sse2, Stereo2Sse2)
+PLANAR_DISPATCH(DeinterleaveSurround8Sse2, Surround8Sse2)
+PLANAR_DISPATCH(DeinterleaveMono1Avx2, Mono1Avx2)
+PLANAR_DISPATCH(DeinterleaveStereo2Avx2, Stereo2Avx2)
+PLANAR_DISPATCH(DeinterleaveSurround8Avx2, Surround8Avx2)
+
+template <int C>
+void DeinterleaveGatherAvx2(const float *src, uint32_t frames,
+                            uint16_t channels, float *const *planar,
+                            float *mono) {
+  if (planar) {
+    GatherAvx2<C, true>(src, frames, channels, planar, mono);
+  } else {
+    GatherAvx2<C, false>(src, frames, channels, planar, mono);
+  }
+}
+
+#endif // KERNELS_X86
+
+} // namespace
+
+KernelIsa DetectKernelIsa() {
+  static const KernelIsa isa = [] {
+#if KERNELS_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+      __cpuid(info, 1);
+      bool os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                    (_xgetbv(0) & 0x6) == 0x6;
+      __cpuidex(info, 7, 0);
+      if (os_avx && (info[1] & (1 << 5))) {
+        return KernelIsa::kAvx2;
+      }
+    }
+    return KernelIsa::kSse2;
+#elif KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return KernelIsa::kAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+      return KernelIsa::kSse2;
+    }
+    return KernelIsa::kScalar;
+#else
+    return KernelIsa::kScalar;
+#endif
+  }();
+  return isa;
+}
+
+const char *KernelIsaName(KernelIsa isa) {
+  switch (isa) {
+  case KernelIsa::kAvx2:
+    return "avx2";
+  case KernelIsa::kSse2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
+DeinterleaveFn GetDeinterleave(uint16_t channels, KernelIsa isa) {
+  isa = std::min(isa, DetectKernelIsa());
+#if KERNELS_X86
+  if (isa == KernelIsa::kAvx2) {
+    switch (channels) {
+    case 1:
+      return DeinterleaveMono1Avx2;
+    case 2:
+      return DeinterleaveStereo2Avx2;
+    case 6:
+      return DeinterleaveGatherAvx2<6>;
+    case 8:
+      return DeinterleaveSurround8Avx2;
+    default:
+      return DeinterleaveGatherAvx2<0>;
+    }
+  }
+  if (isa == KernelIsa::kSse2) {
+    switch (channels) {
+    case 1:
+      return DeinterleaveMono1Sse2;
+    case 2:
+      return DeinterleaveStereo2Sse2;
+    case 8:
+      return DeinterleaveSurround8Sse2;
+    default:
+      break; // compiler vectorized scalar code does as well
+    }
+  }
+#endif
+  switch (channels) {
+  case 1:
+    return DeinterleaveScalar<1>;
+  case 2:
+    return DeinterleaveScalar<2>;
+  case 6:
+    return DeinterleaveScalar<6>;
+  case 8:
+    return DeinterleaveScalar<8>;
+  default:
+    return DeinterleaveScalar<0>;
+  }
+}
+
+MulWindowFn GetMulWindow(KernelIsa isa) {
+  isa = std::min(isa, DetectKernelIsa());
+#if KERNELS_X86
+  if (isa == KernelIsa::kAvx2) {
+    return MulWindowAvx2;
+  }
+  if (isa == KernelIsa::kSse2) {
+    return MulWindowSse2;
+  }
+#endif
+  return MulWindowScalar;
+}
+
+MagnitudeFn GetMagnitude(KernelIsa isa) {
+  return GetSpectrum(SpectrumScale::kMagnitude, isa);
+}
+
+MagnitudeFn GetSpectrum(SpectrumScale scale, KernelIsa isa) {
+  isa = std::min(isa, DetectKernelIsa());
+#if KERNELS_X86
+  if (isa == KernelIsa::kAvx2) {
+    switch (scale) {
+    case SpectrumScale::kPower:
+      return PowerAvx2;
+    case SpectrumScale::kDecibels:
+      return DecibelsAvx2;
+    default:
+      return MagnitudeAvx2;
+    }
+  }
+  if (isa == KernelIsa::kSse2) {
+    switch (scale) {
+    case SpectrumScale::kPower:
+      return PowerSse2;
+    case SpectrumScale::kDecibels:
+      return DecibelsSse2;
+    default:
+      return MagnitudeSse2;
+    }
+  }
+#endif
+  switch (scale) {
+  case SpectrumScale::kPower:
+    return PowerScalar;
+  case SpectrumScale::kDecibels:
+    return DecibelsScalar;
+  default:
+    return MagnitudeScalar;
+  }
+}
+
+DecibelsFn GetDecibels(KernelIsa isa) {
+  isa = std::min(isa, DetectKernelIsa());
+#if KERNELS_X86
+  if (isa == KernelIsa::kAvx2) {
+    return PowerDecibelsAvx2;
+  }
+  if (isa == KernelIsa::kSse2) {
+    return PowerDecibelsSse2;
+  }
+#endif
+  return PowerDecibelsScalar;
+}
+
+SmoothFn GetSmooth(KernelIsa isa) {
+  isa = std::min(isa, DetectKernelIsa());
+#if KERNELS_X86
+  if (isa == KernelIsa::kAvx2) {
+    return SmoothAvx2;
+  }
+  if (isa == KernelIsa::kSse2) {
+    return SmoothSse2;
+  }
+#endif
+  return SmoothScalar;
+}
+
+ConvertFn GetConvert(SampleType type, KernelIsa isa) {
+  isa = std::min(isa, DetectKernelIsa());
+#if KERNELS_X86
+  if (isa == KernelIsa::kAvx2) {
+    switch (type) {
+    case SampleType::kFloat64:
+      return Float64ToFloatAvx2;
+    case SampleType::kInt16:
+      return Int16ToFloatAvx2;
+    case SampleType::kInt24:
+      return Int24ToFloatAvx2;
+    case SampleType::kInt32:
+      return Int32ToFloatAvx2;
+    default:
+      break;
+    }
+  }
+  if (isa == KernelIsa::kSse2) {
+    switch (type) {
+    case SampleType::kFloat64:
+      return Float64ToFloatSse2;
+    case SampleType::kInt16:
+      return Int16ToFloatSse2;
+    case SampleType::kInt32:
+      return Int32ToFloatSse2;
+    default:
+      break; // int24 needs a byte shuffle, SSSE3 and up
+    }
+  }
+#endif
+  switch (type) {
+  case SampleType::kFloat32:
+    return ConvertScalar<SampleType::kFloat32>;
+  case SampleType::kFloat64:
+    return ConvertScalar<SampleType::kFloat64>;
+  case SampleType::kInt16:
+    return ConvertScalar<SampleType::kInt16>;
+  case SampleType::kInt24:
+    return ConvertScalar<SampleType::kInt24>;
+  case SampleType::kInt32:
+    return ConvertScalar<SampleType::kInt32>;
+  default:
+    return nullptr;
+  }
+}
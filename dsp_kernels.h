@@ -0,0 +1,86 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <stdint.h>
+
+#include "audio_source.hpp" // SampleType
+
+// Hot loops of the capture path with SSE2/AVX2 versions picked at runtime.
+// Look a kernel up once (at stream setup) and keep the function pointer.
+
+enum class KernelIsa { kScalar, kSse2, kAvx2 };
+
+// Best instruction set this CPU runs, kScalar off x86.
+KernelIsa DetectKernelIsa();
+const char *KernelIsaName(KernelIsa isa);
+
+// Split `frames` interleaved frames into planar[c][0, frames) and write the
+// channel average to mono[0, frames), in one pass over `src`. `planar` may
+// be null. 1, 2, 6 and 8 channels have specialized versions.
+using DeinterleaveFn = void (*)(const float *src, uint32_t frames,
+                                uint16_t channels, float *const *planar,
+                                float *mono);
+// `isa` above what the CPU supports falls back to the best supported one.
+DeinterleaveFn GetDeinterleave(uint16_t channels,
+                               KernelIsa isa = DetectKernelIsa());
+
+// dst[i] = src[i] * w[i], the window multiply
+using MulWindowFn = void (*)(const float *src, const float *w, float *dst,
+                             uint32_t len);
+MulWindowFn GetMulWindow(KernelIsa isa = DetectKernelIsa());
+
+// dst[i] = |re[i] + i * im[i]| * scale, magnitudes of split complex bins
+using MagnitudeFn = void (*)(const float *re, const float *im, float scale,
+                             float *dst, uint32_t len);
+MagnitudeFn GetMagnitude(KernelIsa isa = DetectKernelIsa());
+
+// What a spectrum bin holds, a = |re + i * im| * scale
+enum class SpectrumScale {
+  kMagnitude, // a
+  kPower,     // a^2
+  kDecibels,  // 20 log10(a), 0 dBFS for a full scale sine, kDecibelFloor
+              // and up. Fast log2, within 1e-4 dB of std::log10.
+};
+constexpr float kDecibelFloor = -120.0f;
+
+// The MagnitudeFn of `scale`, every isa gives identical results
+MagnitudeFn GetSpectrum(SpectrumScale scale, KernelIsa isa = DetectKernelIsa());
+
+// dst[i] = 10 log10(power[i]), kDecibels of spectra summed as power (bands)
+// with the same floor and accuracy. dst may be power. Every isa gives
+// identical results.
+using DecibelsFn = void (*)(const float *power, float *dst, uint32_t len);
+DecibelsFn GetDecibels(KernelIsa isa = DetectKernelIsa());
+
+// Per frame constants of SmoothFn, see SpectrumSmoother
+struct SmoothParams {
+  float inv_frames; // 1 / spectra in the running average
+  float attack;     // share of a rise followed per spectrum, 1 for all of it
+  float release;    // share of a fall
+  float hold;       // spectra a peak stays before it decays
+  float decay;      // what a peak loses per spectrum after that
+};
+// Per bin state of SmoothFn, `len` floats each. A null group skips its
+// stage.
+struct SmoothState {
+  float *sum;    // running sum, and the spectrum leaving it that the
+  float *oldest; // new one replaces
+  float *level;  // attack / release smoothed values
+  float *peak;   // held peaks, and spectra since each was set
+  float *age;
+};
+// In place over x[0, len): the running average, then attack / release
+// smoothing of it, then peak hold of the result with peaks[] getting the
+// peaks (only read with state.peak). One pass, every isa gives identical
+// results.
+using SmoothFn = void (*)(float *x, float *peaks, uint32_t len,
+                          const SmoothParams &params, const SmoothState &state);
+SmoothFn GetSmooth(KernelIsa isa = DetectKernelIsa());
+
+// Convert `samples` samples of one SampleType at `src` to float, full scale
+// to [-1, 1). `src` needs no alignment. Every isa gives identical results.
+using ConvertFn = void (*)(const uint8_t *src, uint32_t samples, float *dst);
+// nullptr for SampleType::kUnsupported
+ConvertFn GetConvert(SampleType type, KernelIsa isa = DetectKernelIsa());
+
+#endif
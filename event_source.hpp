@@ -0,0 +1,159 @@
+#ifndef EVENT_SOURCE_HPP
+#define EVENT_SOURCE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "audio_source.hpp"
+
+// Emulates WASAPI event-driven capture without a device: a "device" thread
+// pulls one period of frames from `inner`, whatever its packet size,
+// waits for the period to elapse, queues it and signals the reader, just
+// like the audio engine sets the AUDCLNT_STREAMFLAGS_EVENTCALLBACK event.
+// When the reader falls more than `queue_len` periods behind, new periods
+// are dropped and counted as overruns.
+class SimulatedEventSource : public AudioSource {
+  struct Packet {
+    std::vector<uint8_t> data;
+    uint32_t frame_num;
+  };
+
+public:
+  // takes ownership of `inner`, which should not pace itself. Its packets
+  // are cut into and joined across periods of `period_frames`, none lost.
+  SimulatedEventSource(AudioSource *inner, uint32_t period_frames,
+                       uint32_t queue_len = 8)
+      : inner_(inner), period_frames_(period_frames), queue_(queue_len),
+        head_(0), size_(0), running_(false), exhausted_(false), overruns_(0) {
+    for (auto &packet : queue_) {
+      packet.data.resize(period_frames * inner_->GetFormat().block_align);
+      packet.frame_num = 0;
+    }
+    uint32_t period_ms =
+        period_frames * 1000 / inner_->GetFormat().sample_rate + 1;
+    wait_time_ = std::chrono::milliseconds(std::max(period_ms * 4, 20u));
+  }
+  ~SimulatedEventSource() override {
+    this->StopService();
+    delete inner_;
+  }
+
+  void StartService() override {
+    if (device_thread_.joinable()) {
+      return;
+    }
+    inner_->StartService();
+    running_ = true;
+    device_thread_ = std::thread(&SimulatedEventSource::DeviceLoop, this);
+  }
+  void StopService() override {
+    if (!device_thread_.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    device_thread_.join();
+    inner_->StopService();
+  }
+
+  void GetBuffer(StopFn stop, CallbackFn callback) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // like WaitForSingleObject with a timeout, so `stop` is polled now and then
+    sample_ready_.wait_for(lock, wait_time_,
+                           [&] { return size_ != 0 || exhausted_; });
+    while (size_ != 0 && !stop()) {
+      Packet &packet = queue_[head_];
+      lock.unlock(); // the device keeps writing while we read
+      callback(packet.data.data(), packet.frame_num);
+      lock.lock();
+      head_ = (head_ + 1) % queue_.size();
+      size_--;
+    }
+  }
+
+  const AudioFormat &GetFormat() const override { return inner_->GetFormat(); }
+
+  bool IsExhausted() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return exhausted_ && size_ == 0;
+  }
+
+  uint64_t GetOverruns() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return overruns_;
+  }
+
+private:
+  void DeviceLoop() {
+    const uint16_t align = GetFormat().block_align;
+    std::vector<uint8_t> period(queue_[0].data.size());
+    std::vector<uint8_t> carry; // frames of packets past the period's end
+    uint32_t frame_num = 0;
+    auto next_period = std::chrono::steady_clock::now();
+    while (true) {
+      // what the last period had no room for comes first
+      frame_num = std::min(uint32_t(carry.size() / align), period_frames_);
+      std::memcpy(period.data(), carry.data(), frame_num * align);
+      carry.erase(carry.begin(), carry.begin() + frame_num * align);
+      while (frame_num < period_frames_ && !inner_->IsExhausted()) {
+        inner_->GetBuffer([] { return false; },
+                          [&](uint8_t *data, uint32_t n) {
+                            uint32_t fit =
+                                std::min(n, period_frames_ - frame_num);
+                            std::memcpy(period.data() + frame_num * align,
+                                        data, fit * align);
+                            frame_num += fit;
+                            carry.insert(carry.end(), data + fit * align,
+                                         data + n * align);
+                          });
+      }
+      next_period += std::chrono::microseconds(
+          uint64_t(period_frames_) * 1000000 / GetFormat().sample_rate);
+      std::this_thread::sleep_until(next_period);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) {
+        return;
+      }
+      if (frame_num != 0) {
+        if (size_ == queue_.size()) {
+          overruns_++; // reader too slow, this period is lost
+        } else {
+          Packet &packet = queue_[(head_ + size_) % queue_.size()];
+          std::memcpy(packet.data.data(), period.data(), frame_num * align);
+          packet.frame_num = frame_num;
+          size_++;
+        }
+      }
+      exhausted_ = inner_->IsExhausted() && carry.empty();
+      sample_ready_.notify_one();
+      if (exhausted_) {
+        return;
+      }
+    }
+  }
+
+  AudioSource *inner_;
+  uint32_t period_frames_;
+  std::chrono::milliseconds wait_time_;
+
+  std::vector<Packet> queue_;
+  size_t head_;
+  size_t size_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable sample_ready_;
+  std::thread device_thread_;
+  bool running_;
+  bool exhausted_;
+  uint64_t overruns_;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef FFT_PLAN_HPP
+#define FFT_PLAN_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+#include "kiss_fft.h"
+#include "kiss_fftr.h"
+
+// What an FftPlan transforms.
+enum class FftLayout {
+  kComplex,   // kiss_fft, nfft complex points
+  kReal,      // kiss_fftr / kiss_fftri, nfft even
+};
+
+// A kiss_fft configuration: twiddles, factors and the real fft tables of
+// one (layout, nfft, direction). It is never written once built, as long
+// as it is driven through the *_scratch functions with the caller's own
+// scratch of GetScratchLen() points, so any number of analyzers on any
+// threads can share one. Get it from GetFftPlan.
+class FftPlan {
+public:
+  FftPlan(FftLayout layout, uint32_t nfft, bool inverse)
+      : layout_(layout), nfft_(nfft), cfg_(nullptr), scratch_len_(0) {
+    switch (layout) {
+    case FftLayout::kComplex:
+      cfg_ = kiss_fft_alloc(int(nfft), inverse, nullptr, nullptr);
+      scratch_len_ = cfg_ ? kiss_fft_scratch_len(Complex()) : 0;
+      break;
+    case FftLayout::kReal:
+      cfg_ = kiss_fftr_alloc(int(nfft), inverse, nullptr, nullptr);
+      scratch_len_ = cfg_ ? kiss_fftr_scratch_len(Real()) : 0;
+      break;
+    }
+    if (cfg_ == nullptr) {
+      throw std::runtime_error("Unsupported fft plan");
+    }
+  }
+  ~FftPlan() { kiss_fft_free(cfg_); }
+  FftPlan(const FftPlan &) = delete;
+  FftPlan &operator=(const FftPlan &) = delete;
+
+  FftLayout GetLayout() const { return layout_; }
+  uint32_t GetLen() const { return nfft_; }
+  // kiss_fft_cpx points every user of the plan needs for itself
+  size_t GetScratchLen() const { return scratch_len_; }
+
+  // the kiss_fft cfg of the plan's layout
+  kiss_fft_cfg Complex() const { return (kiss_fft_cfg)cfg_; }
+  kiss_fftr_cfg Real() const { return (kiss_fftr_cfg)cfg_; }
+
+private:
+  FftLayout layout_;
+  uint32_t nfft_;
+  void *cfg_; // one contiguous kiss_fft allocation
+  size_t scratch_len_;
+};
+
+// Plans are shared per (layout, nfft, direction) and freed with their last
+// user; the cache itself only keeps weak references, so it holds no more
+// than the plans alive. Throws std::runtime_error for sizes kiss_fft
+// refuses (odd real ffts).
+inline std::shared_ptr<const FftPlan>
+GetFftPlan(FftLayout layout, uint32_t nfft, bool inverse = false) {
+  using Key = std::tuple<FftLayout, uint32_t, bool>;
+  static std::mutex mutex;
+  static std::map<Key, std::weak_ptr<const FftPlan>> cache;
+
+  Key key(layout, nfft, inverse);
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const FftPlan> plan = cache[key].lock();
+  if (!plan) {
+    for (auto it = cache.begin(); it != cache.end();) {
+      it = it->second.expired() ? cache.erase(it) : std::next(it);
+    }
+    plan = std::make_shared<const FftPlan>(layout, nfft, inverse);
+    cache[key] = plan;
+  }
+  return plan;
+}
+
+#endif
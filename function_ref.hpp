@@ -0,0 +1,36 @@
+#ifndef FUNCTION_REF_HPP
+#define FUNCTION_REF_HPP
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Non-owning reference to a callable, for callbacks that do not outlive
+// the call they are passed to. Unlike std::function it never allocates or
+// copies the callable: it is a pointer to it and a pointer to a thunk the
+// compiler instantiates (and inlines the callable into) per callable type.
+template <typename Sig> class FunctionRef;
+
+template <typename R, typename... Args> class FunctionRef<R(Args...)> {
+public:
+  template <typename F, typename = std::enable_if_t<!std::is_same<
+                            std::decay_t<F>, FunctionRef>::value>>
+  FunctionRef(F &&f)
+      : object_(const_cast<void *>(
+            static_cast<const void *>(std::addressof(f)))),
+        call_(&Call<std::remove_reference_t<F>>) {}
+
+  R operator()(Args... args) const {
+    return call_(object_, std::forward<Args>(args)...);
+  }
+
+private:
+  template <typename F> static R Call(void *object, Args... args) {
+    return (*static_cast<F *>(object))(std::forward<Args>(args)...);
+  }
+
+  void *object_;
+  R (*call_)(void *, Args...);
+};
+
+#endif
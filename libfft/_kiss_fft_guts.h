@@ -24,10 +24,53 @@
  4*4*4*2
  */
 
+/* Vector butterflies for single float transforms, x86 for now, see
+   _kiss_fft_vec.h. USE_SIMD (four transforms in lockstep) and fixed point
+   builds keep the scalar code. */
+#if !defined(FIXED_POINT) && !defined(USE_SIMD) && \
+    (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+     defined(_M_IX86))
+# define KISS_FFT_VEC 1
+#else
+# define KISS_FFT_VEC 0
+#endif
+
+struct kf_vec_ops{
+    int width; /* complex values per vector, stages need m % width == 0 */
+    void (*bfly2)(kiss_fft_cpx *Fout, const kiss_fft_cpx *tw, int m);
+    void (*bfly4)(kiss_fft_cpx *Fout, const kiss_fft_cpx *tw, int m,
+                  int inverse);
+    int (*fftr_post)(const kiss_fft_cpx *tmpbuf,
+                     const kiss_fft_cpx *super_twiddles,
+                     kiss_fft_cpx *freqdata, int ncfft);
+    int (*fftr_post_split)(const kiss_fft_cpx *tmpbuf,
+                           const kiss_fft_cpx *super_twiddles,
+                           kiss_fft_scalar *re, kiss_fft_scalar *im,
+                           int ncfft);
+};
+
+/* best ops the CPU and kiss_fft_set_simd_level allow, NULL for none */
+const struct kf_vec_ops *kf_vec_select(void);
+
+/* kiss_fft_scratch_len of an nfft point cfg, before there is one */
+int kf_scratch_len(int nfft);
+
 struct kiss_fft_state{
     int nfft;
     int inverse;
     int factors[2*MAXFACTORS];
+#if KISS_FFT_VEC
+    const struct kf_vec_ops *vec;
+    /* per radix 2/4 stage, its twiddles laid out contiguously for the
+       vector butterflies: tw1[0..m) then tw2, tw3; -1 for other stages */
+    int stage_offset[MAXFACTORS];
+    kiss_fft_cpx *stage_twiddles;
+#endif
+    /* room for the largest radix above 5, so kf_bfly_generic does not
+       allocate per call; NULL when every radix has its own butterfly.
+       kiss_fft_scratch passes its own instead. */
+    int scratch_len;
+    kiss_fft_cpx *scratch;
     kiss_fft_cpx twiddles[1];
 };
 
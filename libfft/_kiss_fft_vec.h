@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2003-2010, Mark Borgerding. All rights reserved.
+ *  This file is part of KISS FFT - https://github.com/mborgerding/kissfft
+ *
+ *  SPDX-License-Identifier: BSD-3-Clause
+ *  See COPYING file for more information.
+ */
+
+/* Vectorized radix-2/radix-4 butterflies and kiss_fftr post-processing for
+   one float transform, written once against the vector operations below.
+   kiss_fft_vec.c includes this file once per instruction set after
+   defining them; a NEON build only needs another set of definitions.
+
+   KFV(name)       function name for this instruction set
+   KFV_TARGET      function attribute enabling the instruction set
+   KFV_W           complex values per vector
+   kfv_t           vector type
+   KFV_LOAD(p)     load KFV_W complex values, any alignment
+   KFV_STORE(p, v) store them
+   KFV_ADD, KFV_SUB, KFV_MUL
+   KFV_SET1(x)     every lane x
+   KFV_CMUL(a, b)  complex products, same operations as C_MUL
+   KFV_ROTNEG(a)   a * -i, i.e. (a.i, -a.r)
+   KFV_CONJ(a)     (a.r, -a.i)
+   KFV_REVERSE(a)  complex values in reverse order
+   KFV_SPLIT(a, b, re, im)  the 2 * KFV_W complex values of a then b as
+                   real parts and imaginary parts, one vector each
+
+   The operations mirror the scalar code one for one, so results are the
+   same bit for bit. */
+
+KFV_TARGET static void KFV(bfly2)(kiss_fft_cpx *Fout, const kiss_fft_cpx *tw,
+                                  int m) {
+  int k;
+  for (k = 0; k < m; k += KFV_W) {
+    kfv_t f = KFV_LOAD(Fout + k);
+    kfv_t t = KFV_CMUL(KFV_LOAD(Fout + k + m), KFV_LOAD(tw + k));
+    KFV_STORE(Fout + k + m, KFV_SUB(f, t));
+    KFV_STORE(Fout + k, KFV_ADD(f, t));
+  }
+}
+
+KFV_TARGET static void KFV(bfly4)(kiss_fft_cpx *Fout, const kiss_fft_cpx *tw,
+                                  int m, int inverse) {
+  const kiss_fft_cpx *tw1 = tw, *tw2 = tw + m, *tw3 = tw + 2 * m;
+  int k;
+  for (k = 0; k < m; k += KFV_W) {
+    kfv_t f0 = KFV_LOAD(Fout + k);
+    kfv_t s0 = KFV_CMUL(KFV_LOAD(Fout + k + m), KFV_LOAD(tw1 + k));
+    kfv_t s1 = KFV_CMUL(KFV_LOAD(Fout + k + 2 * m), KFV_LOAD(tw2 + k));
+    kfv_t s2 = KFV_CMUL(KFV_LOAD(Fout + k + 3 * m), KFV_LOAD(tw3 + k));
+    kfv_t s5 = KFV_SUB(f0, s1);
+    kfv_t s3 = KFV_ADD(s0, s2);
+    kfv_t r = KFV_ROTNEG(KFV_SUB(s0, s2));
+    f0 = KFV_ADD(f0, s1);
+    KFV_STORE(Fout + k + 2 * m, KFV_SUB(f0, s3));
+    KFV_STORE(Fout + k, KFV_ADD(f0, s3));
+    if (inverse) {
+      KFV_STORE(Fout + k + m, KFV_SUB(s5, r));
+      KFV_STORE(Fout + k + 3 * m, KFV_ADD(s5, r));
+    } else {
+      KFV_STORE(Fout + k + m, KFV_ADD(s5, r));
+      KFV_STORE(Fout + k + 3 * m, KFV_SUB(s5, r));
+    }
+  }
+}
+
+/* bins k and ncfft - k from the half size complex fft, for k = 1 up to
+   where the two runs of KFV_W bins would meet; returns the first k left */
+KFV_TARGET static int KFV(fftr_post)(const kiss_fft_cpx *tmpbuf,
+                                     const kiss_fft_cpx *super_twiddles,
+                                     kiss_fft_cpx *freqdata, int ncfft) {
+  const kfv_t half = KFV_SET1(.5f);
+  int k;
+  for (k = 1; 2 * k + 2 * KFV_W - 1 <= ncfft; k += KFV_W) {
+    kfv_t fpk = KFV_LOAD(tmpbuf + k);
+    kfv_t fpnk =
+        KFV_CONJ(KFV_REVERSE(KFV_LOAD(tmpbuf + ncfft - k - KFV_W + 1)));
+    kfv_t f1k = KFV_ADD(fpk, fpnk);
+    kfv_t tw = KFV_CMUL(KFV_SUB(fpk, fpnk), KFV_LOAD(super_twiddles + k - 1));
+    KFV_STORE(freqdata + k, KFV_MUL(KFV_ADD(f1k, tw), half));
+    KFV_STORE(freqdata + ncfft - k - KFV_W + 1,
+              KFV_REVERSE(KFV_MUL(KFV_CONJ(KFV_SUB(f1k, tw)), half)));
+  }
+  return k;
+}
+
+/* fftr_post into separate real and imaginary arrays, two vectors of bins
+   per side and iteration so every store is a full vector */
+KFV_TARGET static int KFV(fftr_post_split)(const kiss_fft_cpx *tmpbuf,
+                                           const kiss_fft_cpx *super_twiddles,
+                                           float *re, float *im, int ncfft) {
+  const kfv_t half = KFV_SET1(.5f);
+  kfv_t lo[2], hi[2], r, i;
+  int k, h;
+  for (k = 1; 2 * k + 4 * KFV_W - 1 <= ncfft; k += 2 * KFV_W) {
+    for (h = 0; h < 2; h++) {
+      int kh = k + h * KFV_W;
+      kfv_t fpk = KFV_LOAD(tmpbuf + kh);
+      kfv_t fpnk =
+          KFV_CONJ(KFV_REVERSE(KFV_LOAD(tmpbuf + ncfft - kh - KFV_W + 1)));
+      kfv_t f1k = KFV_ADD(fpk, fpnk);
+      kfv_t tw =
+          KFV_CMUL(KFV_SUB(fpk, fpnk), KFV_LOAD(super_twiddles + kh - 1));
+      lo[h] = KFV_MUL(KFV_ADD(f1k, tw), half);
+      hi[h] = KFV_REVERSE(KFV_MUL(KFV_CONJ(KFV_SUB(f1k, tw)), half));
+    }
+    KFV_SPLIT(lo[0], lo[1], r, i);
+    KFV_STORE(re + k, r);
+    KFV_STORE(im + k, i);
+    /* the second half's bins sit below the first's */
+    KFV_SPLIT(hi[1], hi[0], r, i);
+    KFV_STORE(re + ncfft - k - 2 * KFV_W + 1, r);
+    KFV_STORE(im + ncfft - k - 2 * KFV_W + 1, i);
+  }
+  return k;
+}
+
+static const struct kf_vec_ops KFV(ops) = {KFV_W, KFV(bfly2), KFV(bfly4),
+                                           KFV(fftr_post),
+                                           KFV(fftr_post_split)};
@@ -187,18 +187,21 @@ static void kf_bfly5(kiss_fft_cpx *Fout, const size_t fstride,
 
 /* perform the butterfly for one stage of a mixed radix FFT */
 static void kf_bfly_generic(kiss_fft_cpx *Fout, const size_t fstride,
-                            const kiss_fft_cfg st, int m, int p) {
+                            const kiss_fft_cfg st, int m, int p,
+                            kiss_fft_cpx *scratch) {
   int u, k, q1, q;
   kiss_fft_cpx *twiddles = st->twiddles;
   kiss_fft_cpx t;
   int Norig = st->nfft;
 
-  kiss_fft_cpx *scratch =
-      (kiss_fft_cpx *)KISS_FFT_TMP_ALLOC(sizeof(kiss_fft_cpx) * p);
+#ifdef _OPENMP
+  // the top level stages run in parallel, one scratch cannot be shared
+  scratch = (kiss_fft_cpx *)KISS_FFT_TMP_ALLOC(sizeof(kiss_fft_cpx) * p);
   if (scratch == NULL) {
     KISS_FFT_ERROR("Memory allocation failed.");
     return;
   }
+#endif
 
   for (u = 0; u < m; ++u) {
     k = u;
@@ -222,13 +225,52 @@ static void kf_bfly_generic(kiss_fft_cpx *Fout, const size_t fstride,
       k += m;
     }
   }
+#ifdef _OPENMP
   KISS_FFT_TMP_FREE(scratch);
+#endif
+}
+
+/* recombine the p smaller DFTs of stage `stage` */
+static void kf_bfly(kiss_fft_cpx *Fout, const size_t fstride,
+                    const kiss_fft_cfg st, int m, int p, int stage,
+                    kiss_fft_cpx *scratch) {
+#if KISS_FFT_VEC
+  if (st->vec && st->stage_offset[stage] >= 0 && m % st->vec->width == 0) {
+    const kiss_fft_cpx *tw = st->stage_twiddles + st->stage_offset[stage];
+    if (p == 4) {
+      st->vec->bfly4(Fout, tw, m, st->inverse);
+      return;
+    }
+    st->vec->bfly2(Fout, tw, m);
+    return;
+  }
+#else
+  (void)stage;
+#endif
+  switch (p) {
+  case 2:
+    kf_bfly2(Fout, fstride, st, m);
+    break;
+  case 3:
+    kf_bfly3(Fout, fstride, st, m);
+    break;
+  case 4:
+    kf_bfly4(Fout, fstride, st, m);
+    break;
+  case 5:
+    kf_bfly5(Fout, fstride, st, m);
+    break;
+  default:
+    kf_bfly_generic(Fout, fstride, st, m, p, scratch);
+    break;
+  }
 }
 
 static void kf_work(kiss_fft_cpx *Fout, const kiss_fft_cpx *f,
                     const size_t fstride, int in_stride, int *factors,
-                    const kiss_fft_cfg st) {
+                    const kiss_fft_cfg st, kiss_fft_cpx *scratch) {
   kiss_fft_cpx *Fout_beg = Fout;
+  const int stage = (int)(factors - st->factors) / 2;
   const int p = *factors++; /* the radix  */
   const int m = *factors++; /* stage's fft length/p */
   const kiss_fft_cpx *Fout_end = Fout + p * m;
@@ -243,26 +285,10 @@ static void kf_work(kiss_fft_cpx *Fout, const kiss_fft_cpx *f,
 #pragma omp parallel for
     for (k = 0; k < p; ++k)
       kf_work(Fout + k * m, f + fstride * in_stride * k, fstride * p, in_stride,
-              factors, st);
+              factors, st, scratch);
     // all threads have joined by this point
 
-    switch (p) {
-    case 2:
-      kf_bfly2(Fout, fstride, st, m);
-      break;
-    case 3:
-      kf_bfly3(Fout, fstride, st, m);
-      break;
-    case 4:
-      kf_bfly4(Fout, fstride, st, m);
-      break;
-    case 5:
-      kf_bfly5(Fout, fstride, st, m);
-      break;
-    default:
-      kf_bfly_generic(Fout, fstride, st, m, p);
-      break;
-    }
+    kf_bfly(Fout, fstride, st, m, p, stage, scratch);
     return;
   }
 #endif
@@ -278,7 +304,7 @@ static void kf_work(kiss_fft_cpx *Fout, const kiss_fft_cpx *f,
       // DFT of size m*p performed by doing
       // p instances of smaller DFTs of size m,
       // each one takes a decimated version of the input
-      kf_work(Fout, f, fstride * p, in_stride, factors, st);
+      kf_work(Fout, f, fstride * p, in_stride, factors, st, scratch);
       f += fstride * in_stride;
     } while ((Fout += m) != Fout_end);
   }
@@ -286,23 +312,7 @@ static void kf_work(kiss_fft_cpx *Fout, const kiss_fft_cpx *f,
   Fout = Fout_beg;
 
   // recombine the p smaller DFTs
-  switch (p) {
-  case 2:
-    kf_bfly2(Fout, fstride, st, m);
-    break;
-  case 3:
-    kf_bfly3(Fout, fstride, st, m);
-    break;
-  case 4:
-    kf_bfly4(Fout, fstride, st, m);
-    break;
-  case 5:
-    kf_bfly5(Fout, fstride, st, m);
-    break;
-  default:
-    kf_bfly_generic(Fout, fstride, st, m, p);
-    break;
-  }
+  kf_bfly(Fout, fstride, st, m, p, stage, scratch);
 }
 
 /*  facbuf is populated by p1,m1,p2,m2, ...
@@ -337,6 +347,48 @@ static void kf_factor(int n, int *facbuf) {
   } while (n > 1);
 }
 
+int kf_scratch_len(int nfft) {
+  int factors[2 * MAXFACTORS];
+  int i = 0, len = 0;
+  kf_factor(nfft, factors);
+  do {
+    /* radixes without a dedicated butterfly, nfft 1 is one of radix 1 */
+    if ((factors[i] < 2 || factors[i] > 5) && factors[i] > len)
+      len = factors[i];
+    i += 2;
+  } while (factors[i - 1] > 1);
+  return len;
+}
+
+#if KISS_FFT_VEC
+/* Lays the twiddles of every radix 2/4 stage out contiguously (or only
+   counts them if st is NULL), returns how many there are. */
+static size_t kf_stage_twiddles(const int *factors, kiss_fft_cfg st) {
+  size_t len = 0, fstride = 1;
+  int stage = 0, p, m;
+  do {
+    p = factors[2 * stage];
+    m = factors[2 * stage + 1];
+    if ((p == 2 || p == 4) && m > 1) {
+      if (st) {
+        int j, k;
+        st->stage_offset[stage] = (int)len;
+        for (j = 1; j < p; ++j)
+          for (k = 0; k < m; ++k)
+            st->stage_twiddles[len + (j - 1) * m + k] =
+                st->twiddles[j * k * fstride];
+      }
+      len += (size_t)(p - 1) * m;
+    } else if (st) {
+      st->stage_offset[stage] = -1;
+    }
+    fstride *= p;
+    ++stage;
+  } while (m > 1);
+  return len;
+}
+#endif
+
 /*
  *
  * User-callable function to allocate all necessary storage space for the fft.
@@ -349,9 +401,18 @@ kiss_fft_cfg kiss_fft_alloc(int nfft, int inverse_fft, void *mem,
   KISS_FFT_ALIGN_CHECK(mem)
 
   kiss_fft_cfg st = NULL;
+  size_t stage_len = 0;
+  int i, scratch_len = kf_scratch_len(nfft);
+#if KISS_FFT_VEC
+  int factors[2 * MAXFACTORS];
+  kf_factor(nfft, factors);
+  stage_len = kf_stage_twiddles(factors, NULL);
+#endif
   size_t memneeded = KISS_FFT_ALIGN_SIZE_UP(
       sizeof(struct kiss_fft_state) +
-      sizeof(kiss_fft_cpx) * (nfft - 1)); /* twiddle factors*/
+      sizeof(kiss_fft_cpx) * (nfft - 1) + /* twiddle factors*/
+      sizeof(kiss_fft_cpx) * stage_len +
+      sizeof(kiss_fft_cpx) * scratch_len); /* kf_bfly_generic */
 
   if (lenmem == NULL) {
     st = (kiss_fft_cfg)KISS_FFT_MALLOC(memneeded);
@@ -361,8 +422,8 @@ kiss_fft_cfg kiss_fft_alloc(int nfft, int inverse_fft, void *mem,
     *lenmem = memneeded;
   }
   if (st) {
-    int i;
     st->nfft = nfft;
+    st->scratch_len = scratch_len;
     st->inverse = inverse_fft;
 
     for (i = 0; i < nfft; ++i) {
@@ -375,6 +436,12 @@ kiss_fft_cfg kiss_fft_alloc(int nfft, int inverse_fft, void *mem,
     }
 
     kf_factor(nfft, st->factors);
+#if KISS_FFT_VEC
+    st->vec = kf_vec_select();
+    st->stage_twiddles = st->twiddles + nfft;
+    kf_stage_twiddles(st->factors, st);
+#endif
+    st->scratch = scratch_len ? st->twiddles + nfft + stage_len : NULL;
   }
   return st;
 }
@@ -396,11 +463,11 @@ void kiss_fft_stride(kiss_fft_cfg st, const kiss_fft_cpx *fin,
       return;
     }
 
-    kf_work(tmpbuf, fin, 1, in_stride, st->factors, st);
+    kf_work(tmpbuf, fin, 1, in_stride, st->factors, st, st->scratch);
     memcpy(fout, tmpbuf, sizeof(kiss_fft_cpx) * st->nfft);
     KISS_FFT_TMP_FREE(tmpbuf);
   } else {
-    kf_work(fout, fin, 1, in_stride, st->factors, st);
+    kf_work(fout, fin, 1, in_stride, st->factors, st, st->scratch);
   }
 }
 
@@ -408,6 +475,13 @@ void kiss_fft(kiss_fft_cfg cfg, const kiss_fft_cpx *fin, kiss_fft_cpx *fout) {
   kiss_fft_stride(cfg, fin, fout, 1);
 }
 
+int kiss_fft_scratch_len(kiss_fft_cfg cfg) { return cfg->scratch_len; }
+
+void kiss_fft_scratch(kiss_fft_cfg cfg, const kiss_fft_cpx *fin,
+                      kiss_fft_cpx *fout, kiss_fft_cpx *scratch) {
+  kf_work(fout, fin, 1, 1, cfg->factors, cfg, scratch);
+}
+
 void kiss_fft_cleanup(void) {
   // nothing needed any more
 }
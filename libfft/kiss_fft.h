@@ -133,6 +133,16 @@ void KISS_FFT_API kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx
  * */
 void KISS_FFT_API kiss_fft_stride(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int fin_stride);
 
+/*
+ * kiss_fft_scratch
+ *
+ * kiss_fft (out of place, fin != fout) with the caller's scratch of
+ * kiss_fft_scratch_len(cfg) points instead of the cfg's own: the cfg is
+ * only read, so threads may share one as long as each brings its scratch.
+ * */
+int KISS_FFT_API kiss_fft_scratch_len(kiss_fft_cfg cfg);
+void KISS_FFT_API kiss_fft_scratch(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,kiss_fft_cpx *scratch);
+
 /* If kiss_fft_alloc allocated a buffer, it is one contiguous 
    buffer and can be simply free()d when no longer needed*/
 #define kiss_fft_free KISS_FFT_FREE
@@ -149,6 +159,16 @@ void KISS_FFT_API kiss_fft_cleanup(void);
  */
 int KISS_FFT_API kiss_fft_next_fast_size(int n);
 
+/*
+ * Highest vector instruction set cfgs allocated from now on may use for
+ * radix 2/4 butterflies and kiss_fftr post-processing: 0 scalar, 1 SSE2,
+ * 2 AVX. The default is whatever the CPU supports. Meant for tests and
+ * benchmarks; float builds only, USE_SIMD and FIXED_POINT stay scalar.
+ */
+void KISS_FFT_API kiss_fft_set_simd_level(int level);
+/* level new cfgs get on this CPU */
+int KISS_FFT_API kiss_fft_simd_level(void);
+
 /* for real ffts, we need an even size */
 #define kiss_fftr_next_fast_size_real(n) \
         (kiss_fft_next_fast_size( ((n)+1)>>1)<<1)
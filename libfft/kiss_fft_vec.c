@@ -0,0 +1,164 @@
+/*
+ *  Copyright (c) 2003-2010, Mark Borgerding. All rights reserved.
+ *  This file is part of KISS FFT - https://github.com/mborgerding/kissfft
+ *
+ *  SPDX-License-Identifier: BSD-3-Clause
+ *  See COPYING file for more information.
+ */
+
+#include "_kiss_fft_guts.h"
+
+/* Instruction set selection for the vector butterflies, see
+   _kiss_fft_vec.h. Each cfg picks its ops once in kiss_fft_alloc. */
+
+static int simd_limit = 2;
+
+void kiss_fft_set_simd_level(int level) { simd_limit = level; }
+
+#if KISS_FFT_VEC
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KFV_SSE2
+#define KFV_AVX
+#else
+#define KFV_SSE2 __attribute__((target("sse2")))
+#define KFV_AVX __attribute__((target("avx")))
+#endif
+
+static int cpu_simd_level(void) {
+  static int level = -1;
+  if (level < 0) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    int os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                 (_xgetbv(0) & 0x6) == 0x6;
+    level = os_avx ? 2 : 1;
+#else
+    __builtin_cpu_init();
+    level = __builtin_cpu_supports("avx")    ? 2
+            : __builtin_cpu_supports("sse2") ? 1
+                                             : 0;
+#endif
+  }
+  return level;
+}
+
+/* ---- SSE2, 2 complex per vector ---------------------------------------- */
+
+#define KFV(name) kf_sse2_##name
+#define KFV_TARGET KFV_SSE2
+#define KFV_W 2
+#define kfv_t __m128
+#define KFV_LOAD(p) _mm_loadu_ps((const float *)(p))
+#define KFV_STORE(p, v) _mm_storeu_ps((float *)(p), v)
+#define KFV_ADD _mm_add_ps
+#define KFV_SUB _mm_sub_ps
+#define KFV_MUL _mm_mul_ps
+#define KFV_SET1 _mm_set1_ps
+#define KFV_CMUL kf_sse2_cmul
+#define KFV_ROTNEG(a)                                                          \
+  _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),                    \
+             _mm_setr_ps(0.f, -0.f, 0.f, -0.f))
+#define KFV_CONJ(a) _mm_xor_ps(a, _mm_setr_ps(0.f, -0.f, 0.f, -0.f))
+#define KFV_REVERSE(a) _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2))
+#define KFV_SPLIT(a, b, re, im)                                                \
+  do {                                                                         \
+    re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));                        \
+    im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));                        \
+  } while (0)
+
+/* (a.r*b.r + -(a.i*b.i), a.i*b.r + a.r*b.i) */
+KFV_SSE2 static __m128 kf_sse2_cmul(__m128 a, __m128 b) {
+  __m128 br = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+  __m128 bi = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+  return _mm_add_ps(_mm_mul_ps(a, br),
+                    _mm_xor_ps(_mm_mul_ps(as, bi),
+                               _mm_setr_ps(-0.f, 0.f, -0.f, 0.f)));
+}
+
+#include "_kiss_fft_vec.h"
+
+#undef KFV
+#undef KFV_TARGET
+#undef KFV_W
+#undef kfv_t
+#undef KFV_LOAD
+#undef KFV_STORE
+#undef KFV_ADD
+#undef KFV_SUB
+#undef KFV_MUL
+#undef KFV_SET1
+#undef KFV_CMUL
+#undef KFV_ROTNEG
+#undef KFV_CONJ
+#undef KFV_REVERSE
+#undef KFV_SPLIT
+
+/* ---- AVX, 4 complex per vector ----------------------------------------- */
+
+#define KFV(name) kf_avx_##name
+#define KFV_TARGET KFV_AVX
+#define KFV_W 4
+#define kfv_t __m256
+#define KFV_LOAD(p) _mm256_loadu_ps((const float *)(p))
+#define KFV_STORE(p, v) _mm256_storeu_ps((float *)(p), v)
+#define KFV_ADD _mm256_add_ps
+#define KFV_SUB _mm256_sub_ps
+#define KFV_MUL _mm256_mul_ps
+#define KFV_SET1 _mm256_set1_ps
+#define KFV_CMUL kf_avx_cmul
+#define KFV_ROTNEG(a)                                                          \
+  _mm256_xor_ps(_mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1)),                 \
+                _mm256_setr_ps(0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f))
+#define KFV_CONJ(a)                                                            \
+  _mm256_xor_ps(a, _mm256_setr_ps(0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f))
+#define KFV_REVERSE(a)                                                         \
+  _mm256_permute_ps(_mm256_permute2f128_ps(a, a, 1), _MM_SHUFFLE(1, 0, 3, 2))
+/* lanes to a0 a1 b0 b1 | a2 a3 b2 b3 first, then split within each lane */
+#define KFV_SPLIT(a, b, re, im)                                                \
+  do {                                                                         \
+    __m256 t0 = _mm256_permute2f128_ps(a, b, 0x20);                            \
+    __m256 t1 = _mm256_permute2f128_ps(a, b, 0x31);                            \
+    re = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0));                   \
+    im = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 3, 1));                   \
+  } while (0)
+
+/* addsub: even lanes a.r*b.r - a.i*b.i, odd lanes a.i*b.r + a.r*b.i */
+KFV_AVX static __m256 kf_avx_cmul(__m256 a, __m256 b) {
+  __m256 as = _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1));
+  return _mm256_addsub_ps(_mm256_mul_ps(a, _mm256_moveldup_ps(b)),
+                          _mm256_mul_ps(as, _mm256_movehdup_ps(b)));
+}
+
+#include "_kiss_fft_vec.h"
+
+const struct kf_vec_ops *kf_vec_select(void) {
+  int level = cpu_simd_level();
+  if (simd_limit < level)
+    level = simd_limit;
+  switch (level) {
+  case 2:
+    return &kf_avx_ops;
+  case 1:
+    return &kf_sse2_ops;
+  default:
+    return NULL;
+  }
+}
+
+int kiss_fft_simd_level(void) {
+  int level = cpu_simd_level();
+  return simd_limit < level ? simd_limit : level;
+}
+
+#else /* no vector butterflies for this build */
+
+const struct kf_vec_ops *kf_vec_select(void) { return NULL; }
+
+int kiss_fft_simd_level(void) { return 0; }
+
+#endif
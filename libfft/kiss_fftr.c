@@ -11,7 +11,7 @@
 
 struct kiss_fftr_state{
     kiss_fft_cfg substate;
-    kiss_fft_cpx * tmpbuf;
+    kiss_fft_cpx * tmpbuf; /* kiss_fftr_scratch_len points */
     kiss_fft_cpx * super_twiddles;
 #ifdef USE_SIMD
     void * pad;
@@ -22,7 +22,7 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
 {
 	KISS_FFT_ALIGN_CHECK(mem)
 
-    int i;
+    int i, scratch_len;
     kiss_fftr_cfg st = NULL;
     size_t subsize = 0, memneeded;
 
@@ -33,7 +33,9 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
     nfft >>= 1;
 
     kiss_fft_alloc (nfft, inverse_fft, NULL, &subsize);
-    memneeded = sizeof(struct kiss_fftr_state) + subsize + sizeof(kiss_fft_cpx) * ( nfft * 3 / 2);
+    /* tmpbuf is a whole kiss_fftr_scratch: nfft points and the substate's */
+    scratch_len = nfft + kf_scratch_len(nfft);
+    memneeded = sizeof(struct kiss_fftr_state) + subsize + sizeof(kiss_fft_cpx) * ( scratch_len + nfft / 2);
 
     if (lenmem == NULL) {
         st = (kiss_fftr_cfg) KISS_FFT_MALLOC (memneeded);
@@ -47,7 +49,7 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
 
     st->substate = (kiss_fft_cfg) (st + 1); /*just beyond kiss_fftr_state struct */
     st->tmpbuf = (kiss_fft_cpx *) (((char *) st->substate) + subsize);
-    st->super_twiddles = st->tmpbuf + nfft;
+    st->super_twiddles = st->tmpbuf + scratch_len;
     kiss_fft_alloc(nfft, inverse_fft, st->substate, &subsize);
 
     for (i = 0; i < nfft/2; ++i) {
@@ -60,7 +62,12 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
     return st;
 }
 
-void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+int kiss_fftr_scratch_len(kiss_fftr_cfg st)
+{
+    return st->substate->nfft + kiss_fft_scratch_len(st->substate);
+}
+
+void kiss_fftr_scratch(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata,kiss_fft_cpx *tmpbuf)
 {
     /* input buffer timedata is stored row-wise */
     int k,ncfft;
@@ -74,8 +81,8 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     ncfft = st->substate->nfft;
 
     /*perform the parallel fft of two real signals packed in real,imag*/
-    kiss_fft( st->substate , (const kiss_fft_cpx*)timedata, st->tmpbuf );
-    /* The real part of the DC element of the frequency spectrum in st->tmpbuf
+    kiss_fft_scratch( st->substate , (const kiss_fft_cpx*)timedata, tmpbuf, tmpbuf + ncfft );
+    /* The real part of the DC element of the frequency spectrum in tmpbuf
      * contains the sum of the even-numbered elements of the input time sequence
      * The imag part is the sum of the odd-numbered elements
      *
@@ -85,8 +92,8 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
      *      yielding Nyquist bin of input time sequence
      */
 
-    tdc.r = st->tmpbuf[0].r;
-    tdc.i = st->tmpbuf[0].i;
+    tdc.r = tmpbuf[0].r;
+    tdc.i = tmpbuf[0].i;
     C_FIXDIV(tdc,2);
     CHECK_OVERFLOW_OP(tdc.r ,+, tdc.i);
     CHECK_OVERFLOW_OP(tdc.r ,-, tdc.i);
@@ -98,10 +105,17 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     freqdata[ncfft].i = freqdata[0].i = 0;
 #endif
 
-    for ( k=1;k <= ncfft/2 ; ++k ) {
-        fpk    = st->tmpbuf[k];
-        fpnk.r =   st->tmpbuf[ncfft-k].r;
-        fpnk.i = - st->tmpbuf[ncfft-k].i;
+    k = 1;
+#if KISS_FFT_VEC
+    /* the vector version does what it can, the loop below the rest */
+    if (st->substate->vec)
+        k = st->substate->vec->fftr_post(tmpbuf, st->super_twiddles,
+                                         freqdata, ncfft);
+#endif
+    for ( ;k <= ncfft/2 ; ++k ) {
+        fpk    = tmpbuf[k];
+        fpnk.r =   tmpbuf[ncfft-k].r;
+        fpnk.i = - tmpbuf[ncfft-k].i;
         C_FIXDIV(fpk,2);
         C_FIXDIV(fpnk,2);
 
@@ -116,7 +130,68 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     }
 }
 
-void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata)
+void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+{
+    kiss_fftr_scratch(st, timedata, freqdata, st->tmpbuf);
+}
+
+void kiss_fftr_split_scratch(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_scalar *re,kiss_fft_scalar *im,kiss_fft_cpx *tmpbuf)
+{
+    /* kiss_fftr, storing the bins' real and imaginary parts apart */
+    int k,ncfft;
+    kiss_fft_cpx fpnk,fpk,f1k,f2k,tw,tdc;
+
+    if ( st->substate->inverse) {
+        KISS_FFT_ERROR("kiss fft usage error: improper alloc");
+        return;/* The caller did not call the correct function */
+    }
+
+    ncfft = st->substate->nfft;
+    kiss_fft_scratch( st->substate , (const kiss_fft_cpx*)timedata, tmpbuf, tmpbuf + ncfft );
+
+    tdc.r = tmpbuf[0].r;
+    tdc.i = tmpbuf[0].i;
+    C_FIXDIV(tdc,2);
+    CHECK_OVERFLOW_OP(tdc.r ,+, tdc.i);
+    CHECK_OVERFLOW_OP(tdc.r ,-, tdc.i);
+    re[0] = tdc.r + tdc.i;
+    re[ncfft] = tdc.r - tdc.i;
+#ifdef USE_SIMD
+    im[ncfft] = im[0] = _mm_set1_ps(0);
+#else
+    im[ncfft] = im[0] = 0;
+#endif
+
+    k = 1;
+#if KISS_FFT_VEC
+    if (st->substate->vec)
+        k = st->substate->vec->fftr_post_split(tmpbuf, st->super_twiddles,
+                                               re, im, ncfft);
+#endif
+    for ( ;k <= ncfft/2 ; ++k ) {
+        fpk    = tmpbuf[k];
+        fpnk.r =   tmpbuf[ncfft-k].r;
+        fpnk.i = - tmpbuf[ncfft-k].i;
+        C_FIXDIV(fpk,2);
+        C_FIXDIV(fpnk,2);
+
+        C_ADD( f1k, fpk , fpnk );
+        C_SUB( f2k, fpk , fpnk );
+        C_MUL( tw , f2k , st->super_twiddles[k-1]);
+
+        re[k] = HALF_OF(f1k.r + tw.r);
+        im[k] = HALF_OF(f1k.i + tw.i);
+        re[ncfft-k] = HALF_OF(f1k.r - tw.r);
+        im[ncfft-k] = HALF_OF(tw.i - f1k.i);
+    }
+}
+
+void kiss_fftr_split(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_scalar *re,kiss_fft_scalar *im)
+{
+    kiss_fftr_split_scratch(st, timedata, re, im, st->tmpbuf);
+}
+
+void kiss_fftri_scratch(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata,kiss_fft_cpx *tmpbuf)
 {
     /* input buffer timedata is stored row-wise */
     int k, ncfft;
@@ -128,9 +203,9 @@ void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *t
 
     ncfft = st->substate->nfft;
 
-    st->tmpbuf[0].r = freqdata[0].r + freqdata[ncfft].r;
-    st->tmpbuf[0].i = freqdata[0].r - freqdata[ncfft].r;
-    C_FIXDIV(st->tmpbuf[0],2);
+    tmpbuf[0].r = freqdata[0].r + freqdata[ncfft].r;
+    tmpbuf[0].i = freqdata[0].r - freqdata[ncfft].r;
+    C_FIXDIV(tmpbuf[0],2);
 
     for (k = 1; k <= ncfft / 2; ++k) {
         kiss_fft_cpx fk, fnkc, fek, fok, tmp;
@@ -143,13 +218,18 @@ void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *t
         C_ADD (fek, fk, fnkc);
         C_SUB (tmp, fk, fnkc);
         C_MUL (fok, tmp, st->super_twiddles[k-1]);
-        C_ADD (st->tmpbuf[k],     fek, fok);
-        C_SUB (st->tmpbuf[ncfft - k], fek, fok);
+        C_ADD (tmpbuf[k],     fek, fok);
+        C_SUB (tmpbuf[ncfft - k], fek, fok);
 #ifdef USE_SIMD
-        st->tmpbuf[ncfft - k].i *= _mm_set1_ps(-1.0);
+        tmpbuf[ncfft - k].i *= _mm_set1_ps(-1.0);
 #else
-        st->tmpbuf[ncfft - k].i *= -1;
+        tmpbuf[ncfft - k].i *= -1;
 #endif
     }
-    kiss_fft (st->substate, st->tmpbuf, (kiss_fft_cpx *) timedata);
+    kiss_fft_scratch (st->substate, tmpbuf, (kiss_fft_cpx *) timedata, tmpbuf + ncfft);
+}
+
+void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata)
+{
+    kiss_fftri_scratch(st, freqdata, timedata, st->tmpbuf);
 }
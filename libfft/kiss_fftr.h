@@ -40,12 +40,28 @@ void KISS_FFT_API kiss_fftr(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,ki
  output freqdata has nfft/2+1 complex points
 */
 
+void KISS_FFT_API kiss_fftr_split(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_scalar *re,kiss_fft_scalar *im);
+/*
+ kiss_fftr with split complex output:
+ re and im get the nfft/2+1 real and imaginary parts
+*/
+
 void KISS_FFT_API kiss_fftri(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata);
 /*
  input freqdata has  nfft/2+1 complex points
  output timedata has nfft scalar points
 */
 
+int KISS_FFT_API kiss_fftr_scratch_len(kiss_fftr_cfg cfg);
+void KISS_FFT_API kiss_fftr_scratch(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata,kiss_fft_cpx *scratch);
+void KISS_FFT_API kiss_fftr_split_scratch(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_scalar *re,kiss_fft_scalar *im,kiss_fft_cpx *scratch);
+void KISS_FFT_API kiss_fftri_scratch(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata,kiss_fft_cpx *scratch);
+/*
+ the same with the caller's scratch of kiss_fftr_scratch_len(cfg) points
+ instead of the cfg's own. The cfg is then only read: threads may share
+ one as long as each brings its scratch.
+*/
+
 #define kiss_fftr_free KISS_FFT_FREE
 
 #ifdef __cplusplus
@@ -0,0 +1,136 @@
+#ifndef MULTI_RESOLUTION_FFT_HPP
+#define MULTI_RESOLUTION_FFT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "audio_fft.hpp"
+
+// One window length of a MultiResolutionFFT.
+struct ResolutionConfig {
+  uint32_t len;     // window frames
+  uint32_t hop = 0; // frames between spectra, 0 for len, above len skips
+  WindowType window = WindowType::kHann;
+  float kaiser_beta = 8.6f;
+  FftSize size = FftSize::kExact;
+  SpectrumScale scale = SpectrumScale::kMagnitude;
+};
+
+// Several window lengths at once (say 512 for transients, 4096 and 32768
+// for the bass) over one SignalHistory as long as the longest window: the
+// frames are split into it once and every resolution reads its own window
+// out of it, each on its own hop.
+// Resolution r > 0 runs r / count of the shortest hop after the schedule
+// of resolution 0, so resolutions with hops that are multiples of each
+// other never come due on the same frame: the long transforms land between
+// the short ones instead of piling up on the same packet. That only keeps
+// the costs from adding up; each transform still runs whole, so the packet
+// that gets the longest one pays all of it.
+class MultiResolutionFFT {
+public:
+  // Throws std::runtime_error for no resolutions or more than 32.
+  MultiResolutionFFT(const std::vector<ResolutionConfig> &configs,
+                     const AudioFormat &format,
+                     ChannelMode mode = ChannelMode::kMono)
+      : history_(MaxLen(configs), format, mode), format_(format) {
+    if (configs.empty() || configs.size() > 32) {
+      throw std::runtime_error("Unsupported resolution count");
+    }
+    const uint32_t count = uint32_t(configs.size());
+    uint32_t min_hop = UINT32_MAX;
+    for (const ResolutionConfig &c : configs) {
+      stages_.push_back(new FftStage(c.len, history_.GetSignalCount(),
+                                     c.window, c.kaiser_beta, c.size,
+                                     c.scale));
+      hops_.push_back(c.hop == 0 ? c.len : c.hop);
+      min_hop = std::min(min_hop, hops_.back());
+    }
+    for (uint32_t r = 0; r < count; r++) {
+      first_due_.push_back(hops_[r] +
+                           uint32_t(uint64_t(min_hop) * r / count));
+    }
+    due_ = first_due_;
+  }
+  ~MultiResolutionFFT() {
+    for (FftStage *stage : stages_) {
+      delete stage;
+    }
+  }
+  MultiResolutionFFT(const MultiResolutionFFT &) = delete;
+  MultiResolutionFFT &operator=(const MultiResolutionFFT &) = delete;
+
+  uint32_t GetResolutionCount() { return uint32_t(stages_.size()); }
+  // spectra per hop of every resolution, see ChannelMode
+  uint32_t GetSpectrumCount() { return history_.GetSignalCount(); }
+  uint32_t GetOutputLen(uint32_t r) { return stages_[r]->GetOutputLen(); }
+  uint32_t GetFftLen(uint32_t r) { return stages_[r]->GetFftLen(); }
+  uint32_t GetHop(uint32_t r) { return hops_[r]; }
+  float GetNoiseBandwidth(uint32_t r) {
+    return stages_[r]->GetNoiseBandwidth();
+  }
+  void GetFreqRange(uint32_t r, float *dst) {
+    stages_[r]->GetFreqRange(format_.sample_rate, dst);
+  }
+  // Unscaled complex bins of resolution r's last spectra
+  const float *GetBinsRe(uint32_t r) { return stages_[r]->GetBinsRe(); }
+  const float *GetBinsIm(uint32_t r) { return stages_[r]->GetBinsIm(); }
+
+  // frames still missing before the next resolution is due
+  uint32_t FramesUntilReady() {
+    return *std::min_element(due_.begin(), due_.end());
+  }
+  // frames Write takes before the history wraps
+  uint32_t Contiguous() { return history_.Contiguous(); }
+
+  // As AudioFFT::Write and Commit, n <= min(Contiguous(),
+  // FramesUntilReady()). Commit returns a mask with bit r set when
+  // resolution r got new spectra in dst[r] (GetOutputLen(r) bins per
+  // spectrum); a null `dst` or dst[r] only computes its bins. With
+  // `transform` false the due resolutions are skipped instead, still
+  // reported in the mask, for callers catching up on a backlog.
+  void Write(const float *data, uint32_t n, float *const *planar) {
+    history_.Write(data, n, planar);
+  }
+  // Starts over from silence on the first schedule, for input that
+  // resumes after a gap: no window then spans frames from both sides.
+  void Restart() {
+    history_.Clear();
+    due_ = first_due_;
+  }
+  uint32_t Commit(uint32_t n, float *const *dst, bool transform = true) {
+    history_.Advance(n);
+    uint32_t ready = 0;
+    for (uint32_t r = 0; r < stages_.size(); r++) {
+      if (n < due_[r]) {
+        due_[r] -= n;
+        continue;
+      }
+      if (transform) {
+        stages_[r]->Run(history_, dst ? dst[r] : nullptr);
+      }
+      due_[r] = hops_[r];
+      ready |= 1u << r;
+    }
+    return ready;
+  }
+
+private:
+  static uint32_t MaxLen(const std::vector<ResolutionConfig> &configs) {
+    uint32_t len = 1;
+    for (const ResolutionConfig &c : configs) {
+      len = std::max(len, c.len);
+    }
+    return len;
+  }
+
+  SignalHistory history_; // as long as the longest window
+  AudioFormat format_;
+  std::vector<FftStage *> stages_;
+  std::vector<uint32_t> hops_;
+  std::vector<uint32_t> due_; // frames until each resolution's next fft
+  std::vector<uint32_t> first_due_; // due_ at the start, staggered
+};
+
+#endif
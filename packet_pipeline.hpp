@@ -0,0 +1,194 @@
+#ifndef PACKET_PIPELINE_HPP
+#define PACKET_PIPELINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "block_pool.hpp"
+
+// What PacketPipeline does when analysis falls behind capture.
+enum class Backpressure {
+  // a capture finding no free block recycles the oldest queued one: the
+  // newest audio is kept, the lost frames are counted
+  kDropOldest,
+  // as kDropOldest, and a worker with blocks waiting behind the current
+  // one only keeps its history up to date, transforming nothing until it
+  // reaches the newest block; the windows it skips are counted
+  kCoalesce,
+};
+
+struct PipelineConfig {
+  uint32_t blocks = 64;         // preallocated, all there ever is
+  uint32_t block_frames = 1024; // larger packets take several blocks
+  Backpressure backpressure = Backpressure::kDropOldest;
+};
+
+struct PipelineStats {
+  uint64_t blocks;            // queued by the capture thread
+  uint64_t dropped_blocks;    // recycled before the worker got to them
+  uint64_t dropped_frames;    // lost with those, or with no block at all
+  uint64_t coalesced_windows; // spectra kCoalesce skipped, all resolutions
+  uint64_t max_backlog;       // most blocks ever waiting for the worker
+};
+
+// Hands packets from the capture thread to an analysis worker through a
+// BlockPool. Capture fills free blocks, copying with Push or writing them
+// in place between BeginPush and CommitPush, and queues them; the worker
+// pops, analyses and releases them back. Nothing waits: a pool with no
+// block free makes the capture side take the oldest queued block back
+// (the one queue head both sides advance, by compare and swap), so
+// capture never stalls whatever the analysis costs.
+class PacketPipeline {
+public:
+  struct Block {
+    const uint8_t *data;
+    uint32_t frames;
+    // frames captured before this block's first, lost ones included: a
+    // worker that processed fewer has lost the difference
+    uint64_t first_frame;
+    BlockPool::Handle handle;
+  };
+
+  PacketPipeline(const PipelineConfig &config, uint16_t block_align)
+      : block_frames_(config.block_frames), block_align_(block_align),
+        // one more, kept aside for BeginPush to write what is lost into
+        pool_(size_t(config.block_frames) * block_align, config.blocks + 1),
+        frames_(config.blocks + 1, 0), first_frame_(config.blocks + 1, 0),
+        queue_(config.blocks), pending_(BlockPool::kNoBlock), captured_(0),
+        head_(0), tail_(0), blocks_(0),
+        dropped_blocks_(0), dropped_frames_(0), coalesced_windows_(0),
+        max_backlog_(0) {
+    pool_.Acquire(discard_);
+  }
+  PacketPipeline(const PacketPipeline &) = delete;
+  PacketPipeline &operator=(const PacketPipeline &) = delete;
+
+  uint32_t GetBlockFrames() const { return block_frames_; }
+
+  // Capture side, never blocks or allocates: room for GetBlockFrames()
+  // frames, written and queued by CommitPush(frames written). With every
+  // block held by the worker that is scratch memory and the frames are
+  // counted as dropped.
+  uint8_t *BeginPush() {
+    if (!pool_.Acquire(pending_) && !this->TakeOldest(pending_)) {
+      pending_ = BlockPool::kNoBlock;
+      return pool_.Data(discard_);
+    }
+    return pool_.Data(pending_);
+  }
+  void CommitPush(uint32_t frames) {
+    const uint64_t first_frame = captured_;
+    captured_ += frames;
+    if (pending_ == BlockPool::kNoBlock) {
+      dropped_frames_.fetch_add(frames, std::memory_order_relaxed);
+      return;
+    }
+    if (frames == 0) {
+      pool_.Release(pending_);
+      return;
+    }
+    frames_[pending_] = frames;
+    first_frame_[pending_] = first_frame;
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    queue_[tail % queue_.size()].store(pending_, std::memory_order_relaxed);
+    tail_.store(tail + 1, std::memory_order_release);
+
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t backlog = tail + 1 - head_.load(std::memory_order_relaxed);
+    if (backlog > max_backlog_.load(std::memory_order_relaxed)) {
+      max_backlog_.store(backlog, std::memory_order_relaxed);
+    }
+  }
+  // capture side: copies `frames` frames over as many blocks as it takes
+  void Push(const uint8_t *data, uint32_t frames) {
+    while (frames > 0) {
+      uint8_t *dst = this->BeginPush();
+      if (pending_ == BlockPool::kNoBlock) {
+        this->CommitPush(frames); // this packet is lost
+        return;
+      }
+      uint32_t n = std::min(frames, block_frames_);
+      std::memcpy(dst, data, size_t(n) * block_align_);
+      this->CommitPush(n);
+      data += size_t(n) * block_align_;
+      frames -= n;
+    }
+  }
+
+  // worker side: the oldest queued block, valid until Release
+  bool Pop(Block &block) {
+    BlockPool::Handle handle;
+    if (!this->Dequeue(handle)) {
+      return false;
+    }
+    block = {pool_.Data(handle), frames_[handle], first_frame_[handle],
+             handle};
+    return true;
+  }
+  void Release(const Block &block) { pool_.Release(block.handle); }
+  // blocks queued behind the ones popped, approximate off the worker
+  uint64_t Backlog() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+  void AddCoalescedWindows(uint32_t windows) {
+    coalesced_windows_.fetch_add(windows, std::memory_order_relaxed);
+  }
+
+  // any thread
+  PipelineStats GetStats() const {
+    return {blocks_.load(std::memory_order_relaxed),
+            dropped_blocks_.load(std::memory_order_relaxed),
+            dropped_frames_.load(std::memory_order_relaxed),
+            coalesced_windows_.load(std::memory_order_relaxed),
+            max_backlog_.load(std::memory_order_relaxed)};
+  }
+
+private:
+  // either side: claim the block at the head of the queue
+  bool Dequeue(BlockPool::Handle &id) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (head != tail_.load(std::memory_order_acquire)) {
+      id = queue_[head % queue_.size()].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, head + 1,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  bool TakeOldest(BlockPool::Handle &id) {
+    if (!this->Dequeue(id)) {
+      return false;
+    }
+    dropped_blocks_.fetch_add(1, std::memory_order_relaxed);
+    dropped_frames_.fetch_add(frames_[id], std::memory_order_relaxed);
+    return true;
+  }
+
+  uint32_t block_frames_;
+  uint16_t block_align_;
+  BlockPool pool_;
+  BlockPool::Handle discard_;    // BeginPush's scratch, never queued
+  std::vector<uint32_t> frames_; // in each block, written before queueing
+  std::vector<uint64_t> first_frame_; // Block::first_frame, the same way
+  // capture to worker; the capture side also advances head_ to take
+  // blocks back, so head_ moves by compare and swap
+  std::vector<std::atomic<BlockPool::Handle>> queue_;
+  BlockPool::Handle pending_; // capture side, between Begin and CommitPush
+  uint64_t captured_;         // capture side, frames committed or lost
+  alignas(64) std::atomic<uint64_t> head_;
+  alignas(64) std::atomic<uint64_t> tail_;
+
+  std::atomic<uint64_t> blocks_;
+  std::atomic<uint64_t> dropped_blocks_;
+  std::atomic<uint64_t> dropped_frames_;
+  std::atomic<uint64_t> coalesced_windows_;
+  std::atomic<uint64_t> max_backlog_;
+};
+
+#endif
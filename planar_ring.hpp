@@ -0,0 +1,91 @@
+#ifndef PLANAR_RING_HPP
+#define PLANAR_RING_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// The last `capacity` samples of each of `channels` planar channels in one
+// allocation, every channel starting on a cache line (kAlign). Each
+// channel holds its ring twice over: Advance copies what was just written
+// to the same place in the second half, so the newest n samples always
+// lie end to end, oldest first, and Latest hands them out without copying
+// or unrolling. The second copy costs one extra store per sample; mapping
+// the same pages twice would avoid it, but only for page sized rings and
+// one mapping per channel.
+class PlanarRing {
+public:
+  static constexpr size_t kAlign = 64;
+
+  PlanarRing(uint16_t channels, uint32_t capacity)
+      : channels_(channels), capacity_(capacity),
+        stride_(RoundUp(size_t(capacity) * 2)), pos_(0), planes_(channels) {
+    data_ = static_cast<float *>(::operator new(
+        sizeof(float) * stride_ * channels, std::align_val_t(kAlign)));
+    std::fill(data_, data_ + stride_ * channels, 0.0f);
+  }
+  ~PlanarRing() { ::operator delete(data_, std::align_val_t(kAlign)); }
+  PlanarRing(const PlanarRing &) = delete;
+  PlanarRing &operator=(const PlanarRing &) = delete;
+
+  uint16_t GetChannels() const { return channels_; }
+  uint32_t GetCapacity() const { return capacity_; }
+  // samples per channel Planes takes before the ring wraps
+  uint32_t Contiguous() const { return capacity_ - pos_; }
+
+  // Where the next n <= Contiguous() samples of each channel go, as a
+  // deinterleave kernel wants them. Advance(n) then makes them the newest.
+  float *Plane(uint16_t c) { return data_ + c * stride_ + pos_; }
+  float *const *Planes() {
+    for (uint16_t c = 0; c < channels_; c++) {
+      planes_[c] = this->Plane(c);
+    }
+    return planes_.data();
+  }
+  void Advance(uint32_t n) {
+    for (uint16_t c = 0; c < channels_; c++) {
+      float *written = this->Plane(c);
+      std::copy(written, written + n, written + capacity_);
+    }
+    pos_ += n;
+    if (pos_ == capacity_) {
+      pos_ = 0;
+    }
+  }
+
+  // back to silence, as freshly built
+  void Clear() {
+    std::fill(data_, data_ + stride_ * channels_, 0.0f);
+    pos_ = 0;
+  }
+
+  // the newest n <= GetCapacity() samples of channel c, oldest first
+  const float *Latest(uint16_t c, uint32_t n) const {
+    return this->LatestAt(c, n, pos_);
+  }
+  // The same as of when the write position was `pos` (GetPos). They stay
+  // in place while no more than GetCapacity() - n samples are written,
+  // and since only the writer moves the position, other threads can read
+  // them through this with a pos the writer handed over.
+  uint32_t GetPos() const { return pos_; }
+  const float *LatestAt(uint16_t c, uint32_t n, uint32_t pos) const {
+    return data_ + c * stride_ + pos + capacity_ - n;
+  }
+
+private:
+  static size_t RoundUp(size_t floats) {
+    const size_t per_line = kAlign / sizeof(float);
+    return (floats + per_line - 1) / per_line * per_line;
+  }
+
+  uint16_t channels_;
+  uint32_t capacity_;
+  size_t stride_; // floats from one channel to the next
+  uint32_t pos_;  // next write position in each ring
+  float *data_;
+  std::vector<float *> planes_; // what Planes returns
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SPECTRUM_SMOOTHER_HPP
+#define SPECTRUM_SMOOTHER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "dsp_kernels.h"
+
+// What SpectrumSmoother does to every published spectrum. Times are in
+// seconds of audio, so they mean the same whatever the hop. The defaults
+// change nothing.
+struct SmoothingConfig {
+  uint32_t average = 1; // running average over this many spectra
+  float attack = 0.0f;  // time constant of rising values, 0 follows at once
+  float release = 0.0f; // of falling ones
+  bool peaks = false;   // hold peaks, see SpectrumView::peak
+  float peak_hold = 0.5f;   // how long a peak stays
+  float peak_decay = 20.0f; // how fast it falls after that, per second in
+                            // the units of the spectrum (dB with kDecibels)
+};
+
+// Temporal smoothing of spectra, in place and in one pass over the bins
+// (GetSmooth): the running average of the last spectra, then exponential
+// attack / release smoothing, then peak hold of the result with linear
+// decay. The state lives here, so it goes on across the triple buffer's
+// rotating back buffers.
+class SpectrumSmoother {
+public:
+  // `len` bins per spectrum (all spectra together), one spectrum every
+  // `frame_seconds`, everything starts at `init` (the silence value)
+  SpectrumSmoother(const SmoothingConfig &config, uint32_t len,
+                   float frame_seconds, float init)
+      : smooth_(GetSmooth()), len_(len),
+        frames_(std::max(config.average, 1u)), next_(0), init_(init) {
+    auto follow = [&](float tau) {
+      return tau > 0.0f ? 1.0f - std::exp(-frame_seconds / tau) : 1.0f;
+    };
+    params_.inv_frames = 1.0f / frames_;
+    params_.attack = follow(config.attack);
+    params_.release = follow(config.release);
+    params_.hold = config.peak_hold / frame_seconds;
+    params_.decay = config.peak_decay * frame_seconds;
+
+    state_ = {nullptr, nullptr, nullptr, nullptr, nullptr};
+    if (frames_ > 1) {
+      history_.assign(size_t(frames_) * len, init);
+      sum_.assign(len, init * frames_);
+      state_.sum = sum_.data();
+    }
+    if (config.attack > 0.0f || config.release > 0.0f) {
+      level_.assign(len, init);
+      state_.level = level_.data();
+    }
+    if (config.peaks) {
+      peak_.assign(len, init);
+      age_.assign(len, 0.0f);
+      state_.peak = peak_.data();
+      state_.age = age_.data();
+    }
+  }
+
+  bool HasPeaks() const { return state_.peak != nullptr; }
+
+  // forgets every spectrum so far, as freshly built
+  void Reset() {
+    std::fill(history_.begin(), history_.end(), init_);
+    std::fill(sum_.begin(), sum_.end(), init_ * frames_);
+    std::fill(level_.begin(), level_.end(), init_);
+    std::fill(peak_.begin(), peak_.end(), init_);
+    std::fill(age_.begin(), age_.end(), 0.0f);
+    next_ = 0;
+  }
+
+  // smooths spectrum[0, len) in place, writes peaks[0, len) with HasPeaks()
+  void Apply(float *spectrum, float *peaks) {
+    if (state_.sum) {
+      state_.oldest = history_.data() + size_t(next_) * len_;
+    }
+    smooth_(spectrum, peaks, len_, params_, state_);
+    if (state_.sum && ++next_ == frames_) {
+      next_ = 0;
+      // once per round, sum afresh so rounding does not pile up
+      std::fill(sum_.begin(), sum_.end(), 0.0f);
+      for (uint32_t f = 0; f < frames_; f++) {
+        const float *h = history_.data() + size_t(f) * len_;
+        for (uint32_t i = 0; i < len_; i++) {
+          sum_[i] += h[i];
+        }
+      }
+    }
+  }
+
+private:
+  SmoothFn smooth_;
+  SmoothParams params_;
+  SmoothState state_;
+  uint32_t len_;
+  uint32_t frames_; // in the running average
+  uint32_t next_;   // history_ spectrum the next one replaces
+  float init_;      // the silence value everything starts at
+  std::vector<float> history_; // the last frames_ raw spectra
+  std::vector<float> sum_;
+  std::vector<float> level_;
+  std::vector<float> peak_;
+  std::vector<float> age_;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Wait-free single-producer/single-consumer ring of preallocated slots.
+//
+// The producer fills a slot in place (BeginPush/CommitPush) and the consumer
+// reads it in place (Front/Pop), so nothing is allocated or copied by the
+// ring itself and neither side ever waits for the other. A full ring makes
+// BeginPush return nullptr; what to drop is the producer's decision.
+template <typename T> class SpscRing {
+public:
+  explicit SpscRing(size_t capacity, const T &init = T())
+      : slots_(capacity, init), head_(0), tail_(0) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  // producer side
+  T *BeginPush() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+      return nullptr;
+    }
+    return &slots_[tail % slots_.size()];
+  }
+  void CommitPush() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+  bool TryPush(const T &v) {
+    T *slot = this->BeginPush();
+    if (slot == nullptr) {
+      return false;
+    }
+    *slot = v;
+    this->CommitPush();
+    return true;
+  }
+
+  // consumer side
+  T *Front() {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots_[head % slots_.size()];
+  }
+  void Pop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+  bool TryPop(T &v) {
+    T *slot = this->Front();
+    if (slot == nullptr) {
+      return false;
+    }
+    v = *slot;
+    this->Pop();
+    return true;
+  }
+
+  // exact on either side for its own view, approximate for anyone else
+  size_t Size() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    return size_t(tail_.load(std::memory_order_acquire) - head);
+  }
+  size_t Capacity() const { return slots_.size(); }
+
+private:
+  std::vector<T> slots_;
+  // separate cache lines, producer and consumer never share a written line
+  alignas(64) std::atomic<uint64_t> head_;
+  alignas(64) std::atomic<uint64_t> tail_;
+};
+
+#endif
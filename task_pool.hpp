@@ -0,0 +1,234 @@
+#ifndef TASK_POOL_HPP
+#define TASK_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "wake_word.hpp"
+
+// Which ready stream a TaskPool worker runs first.
+enum class TaskPriority : uint8_t { kLow, kNormal, kHigh };
+
+struct StreamHints {
+  TaskPriority priority = TaskPriority::kNormal;
+  // how soon after Signal the job should be done; among ready streams of
+  // one priority the earliest due runs first. 0 for none: due a second
+  // after the Signal, and never counted as missed.
+  std::chrono::microseconds deadline{0};
+};
+
+struct StreamStats {
+  uint64_t runs;
+  uint64_t steals;          // runs on a worker other than the stream's home
+  uint64_t deadline_misses; // runs that ended after their deadline
+};
+
+// A fixed set of worker threads (one per core by default) running the jobs
+// of many registered streams, instead of a thread per analyzer.
+// A stream is a job (function and argument) that Signal marks ready. Each
+// stream has a home worker, given out in turn at Register, which runs it
+// while it is warm in that core's caches; a worker with nothing ready at
+// home steals the best ready stream of the others. Best is the highest
+// priority, then the earliest due (Signal time plus deadline).
+// One stream's job never runs on two workers at once: a Signal during a
+// run makes it run again afterwards, Signals before a run coalesce into it.
+// Signal is a few atomic operations and at most one futex wake, safe from
+// a real-time thread. Idle workers block on that futex (see WakeWord).
+class TaskPool {
+public:
+  using StreamFn = void (*)(void *);
+  using StreamId = uint32_t;
+  static constexpr uint32_t kMaxStreams = 64;
+  // how often Unregister looks whether a running job ended
+  static constexpr std::chrono::microseconds kUnregisterPoll{500};
+
+  explicit TaskPool(uint32_t threads = 0) : stop_(false), next_home_(0) {
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (uint32_t w = 0; w < threads; w++) {
+      workers_.emplace_back(&TaskPool::Work, this, w);
+    }
+  }
+  ~TaskPool() {
+    stop_ = true;
+    wake_.Notify(true);
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  uint32_t GetThreadCount() const { return uint32_t(workers_.size()); }
+
+  // Control thread. Throws std::runtime_error past kMaxStreams.
+  StreamId Register(StreamFn fn, void *arg, const StreamHints &hints = {}) {
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    for (StreamId id = 0; id < kMaxStreams; id++) {
+      Slot &slot = slots_[id];
+      if (slot.state.load(std::memory_order_relaxed) != kFree) {
+        continue;
+      }
+      slot.fn = fn;
+      slot.arg = arg;
+      slot.priority = hints.priority;
+      slot.deadline_ns = hints.deadline.count() * 1000;
+      slot.home = next_home_++ % GetThreadCount();
+      slot.runs = slot.steals = slot.deadline_misses = 0;
+      slot.state.store(kIdle, std::memory_order_release);
+      return id;
+    }
+    throw std::runtime_error("Too many task pool streams");
+  }
+  // Control thread. Waits for a running job to end; a pending one is
+  // dropped. The job never runs again after this returns.
+  void Unregister(StreamId id) {
+    Slot &slot = slots_[id];
+    uint8_t state = slot.state.load(std::memory_order_acquire);
+    while (state != kFree) {
+      if ((state == kIdle || state == kReady) &&
+          slot.state.compare_exchange_weak(state, kFree,
+                                           std::memory_order_acq_rel)) {
+        return;
+      }
+      if (state == kRunning || state == kRerun) {
+        std::this_thread::sleep_for(kUnregisterPoll);
+        state = slot.state.load(std::memory_order_acquire);
+      }
+    }
+  }
+
+  // Any thread: run the stream's job soon.
+  void Signal(StreamId id) {
+    Slot &slot = slots_[id];
+    uint8_t state = slot.state.load(std::memory_order_acquire);
+    while (true) {
+      if (state == kIdle) {
+        slot.ready_ns.store(Now(), std::memory_order_relaxed);
+        if (slot.state.compare_exchange_weak(state, kReady,
+                                             std::memory_order_acq_rel)) {
+          wake_.Notify();
+          return;
+        }
+      } else if (state == kRunning) {
+        if (slot.state.compare_exchange_weak(state, kRerun,
+                                             std::memory_order_acq_rel)) {
+          return;
+        }
+      } else {
+        return; // already pending, or not registered
+      }
+    }
+  }
+
+  StreamStats GetStats(StreamId id) const {
+    const Slot &slot = slots_[id];
+    return {slot.runs.load(std::memory_order_acquire),
+            slot.steals.load(std::memory_order_relaxed),
+            slot.deadline_misses.load(std::memory_order_relaxed)};
+  }
+
+private:
+  enum : uint8_t { kFree, kIdle, kReady, kRunning, kRerun };
+  static constexpr int64_t kNoDeadlineNs = 1000000000;
+
+  struct alignas(64) Slot {
+    std::atomic<uint8_t> state{kFree};
+    std::atomic<int64_t> ready_ns{0}; // last Signal that made it ready
+    // set by Register before the state leaves kFree
+    StreamFn fn = nullptr;
+    void *arg = nullptr;
+    TaskPriority priority = TaskPriority::kNormal;
+    int64_t deadline_ns = 0;
+    uint32_t home = 0;
+    std::atomic<uint64_t> runs{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> deadline_misses{0};
+  };
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+  int64_t Due(const Slot &slot) const {
+    return slot.ready_ns.load(std::memory_order_relaxed) +
+           (slot.deadline_ns > 0 ? slot.deadline_ns : kNoDeadlineNs);
+  }
+
+  // best ready stream, homed on `worker` or anywhere else, -1 for none
+  int Pick(uint32_t worker, bool home) const {
+    int best = -1;
+    for (int id = 0; id < int(kMaxStreams); id++) {
+      const Slot &slot = slots_[id];
+      if (slot.state.load(std::memory_order_acquire) != kReady ||
+          (slot.home == worker) != home) {
+        continue;
+      }
+      if (best < 0 || slot.priority > slots_[best].priority ||
+          (slot.priority == slots_[best].priority &&
+           Due(slot) < Due(slots_[best]))) {
+        best = id;
+      }
+    }
+    return best;
+  }
+
+  void Work(uint32_t worker) {
+    while (true) {
+      // before looking, so a Signal or the destructor after the look
+      // still wakes us
+      const uint32_t seen = wake_.Prepare();
+      if (stop_.load(std::memory_order_relaxed)) {
+        return;
+      }
+      bool stolen = false;
+      int id = this->Pick(worker, true);
+      if (id < 0) {
+        id = this->Pick(worker, false);
+        stolen = true;
+      }
+      if (id < 0) {
+        wake_.Wait(seen);
+        continue;
+      }
+      Slot &slot = slots_[id];
+      uint8_t ready = kReady;
+      if (!slot.state.compare_exchange_strong(ready, kRunning,
+                                              std::memory_order_acq_rel)) {
+        continue; // another worker got it first
+      }
+      const int64_t due = this->Due(slot);
+      slot.fn(slot.arg);
+      slot.steals.fetch_add(stolen, std::memory_order_relaxed);
+      if (slot.deadline_ns > 0 && Now() > due) {
+        slot.deadline_misses.fetch_add(1, std::memory_order_relaxed);
+      }
+      // last: stats read after it include this run
+      slot.runs.fetch_add(1, std::memory_order_release);
+      uint8_t running = kRunning;
+      if (!slot.state.compare_exchange_strong(running, kIdle,
+                                              std::memory_order_acq_rel)) {
+        // signalled while running
+        slot.ready_ns.store(Now(), std::memory_order_relaxed);
+        slot.state.store(kReady, std::memory_order_release);
+      }
+    }
+  }
+
+  Slot slots_[kMaxStreams];
+  std::vector<std::thread> workers_;
+  std::atomic<bool> stop_;
+  WakeWord wake_; // idle workers sleep on it, Signal wakes one
+  std::mutex register_mutex_; // Register calls among themselves
+  uint32_t next_home_;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "audio_fft.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Time of one AudioFFT spectrum (stereo downmix, Hann) for the windows
+// AudioThread derives from common rates and hz gaps, per FftSize policy.
+int main() {
+  const char *names[] = {"exact", "fast", "pow2"};
+  std::printf("%-6s %-6s %-5s %-6s %-6s %12s\n", "rate", "hz", "size", "len",
+              "nfft", "us/frame");
+  for (uint32_t rate : {44100u, 48000u}) {
+    AudioFormat format;
+    format.sample_rate = rate;
+    format.channels = 2;
+    format.bits_per_sample = 32;
+    format.block_align = 8;
+    format.sample_type = SampleType::kFloat32;
+    for (uint32_t hz_gap : {100u, 50u, 20u, 10u}) {
+      uint32_t len = rate / hz_gap;
+      len -= len % 2;
+      std::vector<float> in(len * 2), out(len);
+      for (uint32_t i = 0; i < len * 2; i++) {
+        in[i] = std::sin(0.37f * i);
+      }
+      for (FftSize size :
+           {FftSize::kExact, FftSize::kFast, FftSize::kPowerOfTwo}) {
+        AudioFFT fft(len, format, 0, WindowType::kHann, 8.6f,
+                     ChannelMode::kMono, size);
+        out.resize(fft.GetOutputLen());
+        const int rounds = 20000000 / len + 10;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+          fft.GetAmplitude(in.data(), len, out.data());
+        }
+        double sec = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+        std::printf("%-6u %-6u %-5s %-6u %-6u %12.2f\n", rate, hz_gap,
+                    names[int(size)], len, fft.GetFftLen(),
+                    sec / rounds * 1e6);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,254 @@
+#include "audio_fft.hpp"
+#include "expect.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static AudioFormat StereoFloat(uint32_t sample_rate) {
+  AudioFormat format;
+  format.sample_rate = sample_rate;
+  format.channels = 2;
+  format.bits_per_sample = 32;
+  format.block_align = 8;
+  format.sample_type = SampleType::kFloat32;
+  return format;
+}
+
+// amplitude spectrum of signal[end - len, end), the way AudioFFT scales it
+static std::vector<float> Reference(const std::vector<float> &mono,
+                                    size_t end, uint32_t len) {
+  kiss_fftr_cfg cfg = kiss_fftr_alloc(len, false, nullptr, nullptr);
+  std::vector<kiss_fft_cpx> out(len / 2 + 1);
+  kiss_fftr(cfg, mono.data() + end - len, out.data());
+  kiss_fftr_free(cfg);
+  std::vector<float> amplitude(out.size());
+  for (size_t i = 0; i < out.size(); i++) {
+    amplitude[i] = std::hypot(out[i].r, out[i].i) * 2 / (float)len;
+  }
+  return amplitude;
+}
+
+int main() {
+  const uint32_t len = 512, hop = len / 4;
+  const uint32_t frame_len = 4800;
+  AudioFormat format = StereoFloat(48000);
+
+  // left and right differ so the downmix is exercised
+  std::vector<float> interleaved(frame_len * 2), mono(frame_len);
+  for (uint32_t i = 0; i < frame_len; i++) {
+    interleaved[2 * i] = std::sin(0.05f * i);
+    interleaved[2 * i + 1] = 0.5f * std::sin(0.31f * i);
+    mono[i] = (interleaved[2 * i] + interleaved[2 * i + 1]) / 2;
+  }
+
+  // 75% overlap: a spectrum every hop, each one of the last len frames,
+  // no matter how the input is split into packets
+  AudioFFT fft(len, format, hop);
+  EXPECT(fft.GetHop() == hop)
+  std::vector<float> spectrum(fft.GetOutputLen());
+  uint32_t pos = 0, spectra = 0;
+  bool match = true;
+  for (uint32_t packet : {7u, 300u, 1u, 1000u}) {
+    while (pos < frame_len) {
+      uint32_t n = std::min({packet, fft.FramesUntilReady(), frame_len - pos});
+      bool ready = fft.GetAmplitude(interleaved.data() + 2 * pos, n,
+                                    spectrum.data());
+      pos += n;
+      if (ready) {
+        EXPECT(pos % hop == 0)
+        spectra++;
+        if (pos >= len) {
+          std::vector<float> ref = Reference(mono, pos, len);
+          for (size_t i = 0; i < ref.size(); i++) {
+            match &= std::abs(ref[i] - spectrum[i]) < 1e-4f;
+          }
+        }
+      }
+      if (pos % 1200 == 0) {
+        break; // next packet size
+      }
+    }
+  }
+  EXPECT(spectra == frame_len / hop)
+  EXPECT(match)
+
+  // per channel and mid/side: every signal's spectrum in one call
+  std::vector<float> left(frame_len), right(frame_len), mid(frame_len),
+      side(frame_len);
+  for (uint32_t i = 0; i < frame_len; i++) {
+    left[i] = interleaved[2 * i];
+    right[i] = interleaved[2 * i + 1];
+    mid[i] = mono[i];
+    side[i] = (left[i] - right[i]) / 2;
+  }
+  for (ChannelMode mode : {ChannelMode::kPerChannel, ChannelMode::kMidSide}) {
+    AudioFFT multi(len, format, hop, WindowType::kRectangular, 8.6f, mode);
+    EXPECT(multi.GetSpectrumCount() == 2)
+    std::vector<float> spectra(2 * multi.GetOutputLen());
+    std::vector<float> planar_l(len), planar_r(len);
+    float *planar[] = {planar_l.data(), planar_r.data()};
+    uint32_t n = 2 * len;
+    for (uint32_t p = 0; p < n;) {
+      uint32_t step = std::min({multi.Contiguous(), multi.FramesUntilReady(),
+                                uint32_t(333)});
+      multi.Write(interleaved.data() + 2 * p, step, planar);
+      EXPECT(planar_l[step - 1] == left[p + step - 1])
+      EXPECT(planar_r[0] == right[p])
+      multi.Commit(step, spectra.data());
+      p += step;
+    }
+    bool per_signal = true;
+    const auto &a = mode == ChannelMode::kPerChannel ? left : mid;
+    const auto &b = mode == ChannelMode::kPerChannel ? right : side;
+    std::vector<float> ref_a = Reference(a, n, len);
+    std::vector<float> ref_b = Reference(b, n, len);
+    for (size_t i = 0; i < ref_a.size(); i++) {
+      per_signal &= std::abs(ref_a[i] - spectra[i]) < 1e-4f;
+      per_signal &= std::abs(ref_b[i] - spectra[ref_a.size() + i]) < 1e-4f;
+    }
+    EXPECT(per_signal)
+  }
+
+  // hop 0 means back to back windows
+  AudioFFT plain(len, format);
+  EXPECT(plain.GetHop() == len)
+
+  // a hop beyond the window keeps its rate, the frames between are skipped
+  {
+    AudioFFT sparse(len, format, 3 * len);
+    EXPECT(sparse.GetHop() == 3 * len)
+    uint32_t at = 0, count = 0;
+    bool newest = true;
+    while (at < frame_len) {
+      uint32_t n = std::min(sparse.FramesUntilReady(), frame_len - at);
+      bool ready = sparse.GetAmplitude(interleaved.data() + 2 * at, n,
+                                       spectrum.data());
+      at += n;
+      if (ready) {
+        count++;
+        std::vector<float> ref = Reference(mono, at, len);
+        for (size_t i = 0; i < ref.size(); i++) {
+          newest &= std::abs(ref[i] - spectrum[i]) < 1e-4f;
+        }
+      }
+    }
+    EXPECT(count == frame_len / (3 * len))
+    EXPECT(newest)
+  }
+
+  // window tables are shared per (type, len, beta)
+  auto hann = GetWindow(WindowType::kHann, len);
+  EXPECT(hann == GetWindow(WindowType::kHann, len))
+  EXPECT(hann != GetWindow(WindowType::kHann, len * 2))
+  EXPECT(GetWindow(WindowType::kKaiser, len, 5.0f) !=
+         GetWindow(WindowType::kKaiser, len, 8.0f))
+  EXPECT(hann->coeffs[0] == 0.0f && hann->coeffs[len / 2] == 1.0f)
+  EXPECT(std::abs(hann->coherent_gain - 0.5f) < 1e-6f)
+  EXPECT(std::abs(hann->noise_bandwidth - 1.5f) < 1e-5f)
+  EXPECT(std::abs(GetWindow(WindowType::kHamming, len)->coherent_gain -
+                  0.54f) < 1e-6f)
+  EXPECT(std::abs(GetWindow(WindowType::kBlackmanHarris, len)->coherent_gain -
+                  0.35875f) < 1e-6f)
+  auto kaiser = GetWindow(WindowType::kKaiser, len);
+  EXPECT(kaiser->coeffs[len / 2] == 1.0f)
+  EXPECT(std::abs(kaiser->coeffs[1] - kaiser->coeffs[len - 1]) < 1e-6f)
+
+  // windowed amplitudes stay calibrated; flat top even between bins
+  for (WindowType type : {WindowType::kHann, WindowType::kBlackmanHarris,
+                          WindowType::kFlatTop, WindowType::kKaiser}) {
+    for (float bin : {32.0f, 32.5f}) {
+      if (bin != 32.0f && type != WindowType::kFlatTop) {
+        continue;
+      }
+      std::vector<float> tone(len * 2);
+      for (uint32_t i = 0; i < len; i++) {
+        tone[2 * i] = tone[2 * i + 1] =
+            0.8f * std::cos(2 * 3.14159265f * bin * i / len);
+      }
+      AudioFFT windowed(len, format, 0, type);
+      EXPECT(windowed.GetAmplitude(tone.data(), len, spectrum.data()))
+      float peak = *std::max_element(spectrum.begin(), spectrum.end());
+      EXPECT(std::abs(peak - 0.8f) < 2e-3f)
+    }
+  }
+
+  // dBFS output: the same peak in decibels, silence on the floor
+  std::vector<float> tone_db(len * 2, 0.0f);
+  AudioFFT decibels(len, format, 0, WindowType::kHann, 8.6f,
+                    ChannelMode::kMono, FftSize::kExact,
+                    SpectrumScale::kDecibels);
+  EXPECT(decibels.GetAmplitude(tone_db.data(), len, spectrum.data()))
+  EXPECT(*std::max_element(spectrum.begin(), spectrum.end()) ==
+         kDecibelFloor)
+  for (uint32_t i = 0; i < len; i++) {
+    tone_db[2 * i] = tone_db[2 * i + 1] =
+        0.8f * std::cos(2 * 3.14159265f * 32 * i / len);
+  }
+  EXPECT(decibels.GetAmplitude(tone_db.data(), len, spectrum.data()))
+  EXPECT(std::abs(spectrum[32] - 20 * std::log10(0.8f)) < 1e-3f)
+
+  // fast sizes zero-pad a 44.1 kHz / 50 Hz window: 882 = 2 3^2 7^2 frames
+  // go through a 900 point fft, bins 49 Hz apart
+  AudioFormat cd = StereoFloat(44100);
+  EXPECT(AudioFFT::FftLen(882, FftSize::kExact) == 882)
+  EXPECT(AudioFFT::FftLen(882, FftSize::kFast) == 900)
+  EXPECT(AudioFFT::FftLen(882, FftSize::kPowerOfTwo) == 1024)
+  AudioFFT padded(882, cd, 0, WindowType::kRectangular, 8.6f,
+                  ChannelMode::kMono, FftSize::kFast);
+  EXPECT(padded.GetFftLen() == 900 && padded.GetOutputLen() == 451)
+  std::vector<float> padded_freqs(padded.GetOutputLen()),
+      padded_spectrum(padded.GetOutputLen()), tone(882 * 2);
+  padded.GetFreqRange(padded_freqs.data());
+  EXPECT(padded_freqs[20] == 980.0f)
+  for (uint32_t i = 0; i < 882; i++) {
+    tone[2 * i] = tone[2 * i + 1] =
+        0.5f * std::sin(2 * 3.14159265f * 980 * i / 44100);
+  }
+  EXPECT(padded.GetAmplitude(tone.data(), 882, padded_spectrum.data()))
+  auto peak = std::max_element(padded_spectrum.begin(), padded_spectrum.end());
+  EXPECT(peak - padded_spectrum.begin() == 20)
+  EXPECT(std::abs(*peak - 0.5f) < 5e-3f)
+
+  // plans are shared per (layout, size, direction) and die with their users
+  auto plan = GetFftPlan(FftLayout::kReal, 308);
+  EXPECT(plan == GetFftPlan(FftLayout::kReal, 308))
+  EXPECT(plan != GetFftPlan(FftLayout::kReal, 308, true))
+  EXPECT(plan != GetFftPlan(FftLayout::kComplex, 308))
+  std::weak_ptr<const FftPlan> weak = plan;
+  // one plan, four threads with their own scratch: all get kiss_fftr's bins
+  // (308 = 2 2 7 11, the generic butterfly works in the scratch)
+  std::vector<float> signal(308);
+  for (uint32_t i = 0; i < 308; i++) {
+    signal[i] = std::sin(0.21f * i) + 0.1f * (i % 7);
+  }
+  std::vector<kiss_fft_cpx> expected(155);
+  kiss_fftr_cfg own = kiss_fftr_alloc(308, 0, nullptr, nullptr);
+  kiss_fftr(own, signal.data(), expected.data());
+  kiss_fftr_free(own);
+  std::vector<std::thread> threads;
+  bool shared_same[4] = {};
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      std::vector<kiss_fft_cpx> scratch(plan->GetScratchLen()), out(155);
+      bool same = true;
+      for (int r = 0; r < 200; r++) {
+        kiss_fftr_scratch(plan->Real(), signal.data(), out.data(),
+                          scratch.data());
+        for (int k = 0; k < 155; k++) {
+          same &= out[k].r == expected[k].r && out[k].i == expected[k].i;
+        }
+      }
+      shared_same[t] = same;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT(shared_same[0] && shared_same[1] && shared_same[2] && shared_same[3])
+  plan.reset();
+  EXPECT(weak.expired())
+
+  std::cout << "audio_fft_test passed\n";
+  return 0;
+}
@@ -0,0 +1,633 @@
+#include "audio_thread.h"
+#include "event_source.hpp"
+#include "tone_source.hpp"
+#include "wav_source.hpp"
+#include "expect.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// every sample the source delivers, converted to float
+static std::vector<float> Drain(AudioSource &source) {
+  std::vector<float> out;
+  ConvertFn convert = GetConvert(source.GetFormat().sample_type);
+  source.StartService();
+  while (!source.IsExhausted()) {
+    source.GetBuffer([] { return false; },
+                     [&](uint8_t *data, uint32_t frame_len) {
+                       size_t len = out.size();
+                       uint32_t samples =
+                           frame_len * source.GetFormat().channels;
+                       out.resize(len + samples);
+                       convert(data, samples, out.data() + len);
+                     });
+  }
+  source.StopService();
+  return out;
+}
+
+template <typename T> static void Put(std::ofstream &os, T v) {
+  os.write((const char *)&v, sizeof(T));
+}
+
+static void WriteWav(const char *path, uint16_t tag, uint16_t channels,
+                     uint32_t rate, uint16_t bits, const void *data,
+                     uint32_t len) {
+  std::ofstream os(path, std::ios::binary);
+  os.write("RIFF", 4);
+  Put<uint32_t>(os, 36 + len);
+  os.write("WAVEfmt ", 8);
+  Put<uint32_t>(os, 16);
+  Put<uint16_t>(os, tag);
+  Put<uint16_t>(os, channels);
+  Put<uint32_t>(os, rate);
+  Put<uint32_t>(os, rate * channels * bits / 8);
+  Put<uint16_t>(os, channels * bits / 8);
+  Put<uint16_t>(os, bits);
+  os.write("data", 4);
+  Put<uint32_t>(os, len);
+  os.write((const char *)data, len);
+}
+
+// A pool job that keeps its worker until released.
+struct PoolHold {
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+
+  static void Job(void *self) {
+    PoolHold *h = static_cast<PoolHold *>(self);
+    h->entered = true;
+    while (!h->release) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+};
+
+// A loud tone for the first `loud` packets, a quiet one after, never more
+// packets than Allow let out so far.
+class GatedTone : public AudioSource {
+public:
+  GatedTone(const ToneConfig &loud, const ToneConfig &quiet,
+            uint32_t loud_packets)
+      : loud_(loud), quiet_(quiet), loud_packets_(loud_packets), served_(0),
+        allowed_(0) {}
+  void Allow(uint32_t packets) { allowed_ += packets; }
+  void StartService() override {}
+  void StopService() override {}
+  void GetBuffer(StopFn stop, CallbackFn callback) override {
+    while (served_ == allowed_) {
+      if (stop()) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    ToneSource &tone = served_ < loud_packets_ ? loud_ : quiet_;
+    tone.GetBuffer([] { return false; }, callback);
+    served_++;
+  }
+  const AudioFormat &GetFormat() const override { return loud_.GetFormat(); }
+  bool IsExhausted() const override { return false; }
+
+private:
+  ToneSource loud_;
+  ToneSource quiet_;
+  uint32_t loud_packets_;
+  std::atomic<uint32_t> served_;
+  std::atomic<uint32_t> allowed_;
+};
+
+// A tone that counts how many of its kind were deleted.
+class CountedTone : public ToneSource {
+public:
+  explicit CountedTone(const ToneConfig &config) : ToneSource(config) {}
+  ~CountedTone() override { deleted++; }
+  static int deleted;
+};
+int CountedTone::deleted = 0;
+
+int main() {
+  // same seed, same samples
+  ToneConfig config;
+  config.noise = 0.1f;
+  config.total_frames = 4800;
+  ToneSource tone_a(config), tone_b(config);
+  std::vector<float> a = Drain(tone_a), b = Drain(tone_b);
+  EXPECT(a.size() == 4800 * 2)
+  EXPECT(a == b)
+
+  // filled in place in pieces smaller than a packet, the same samples
+  ToneSource tone_c(config);
+  EXPECT(tone_c.CanFill())
+  std::vector<float> c(4800 * 2);
+  uint32_t filled = 0, n;
+  tone_c.StartService();
+  while ((n = tone_c.Fill([] { return false; },
+                          (uint8_t *)(c.data() + filled * 2), 100)) > 0) {
+    filled += n;
+  }
+  EXPECT(filled == 4800 && tone_c.IsExhausted())
+  EXPECT(c == a)
+
+  // wav replay in the file's own format
+  std::vector<float> f32 = {0.0f, 0.5f, -0.5f, 0.25f, 1.0f, -1.0f};
+  WriteWav("audio_source_test_f32.wav", 3, 2, 44100, 32, f32.data(),
+           uint32_t(f32.size() * sizeof(float)));
+  WavFileSource wav_f32("audio_source_test_f32.wav", 2);
+  EXPECT(wav_f32.GetFormat().channels == 2)
+  EXPECT(wav_f32.GetFormat().sample_rate == 44100)
+  EXPECT(Drain(wav_f32) == f32)
+
+  std::vector<int16_t> s16 = {0, 16384, -16384, -32768};
+  WriteWav("audio_source_test_s16.wav", 1, 1, 8000, 16, s16.data(),
+           uint32_t(s16.size() * sizeof(int16_t)));
+  WavFileSource wav_s16("audio_source_test_s16.wav", 3);
+  EXPECT(wav_s16.GetFormat().sample_type == SampleType::kInt16)
+  EXPECT(wav_s16.GetFormat().block_align == 2)
+  EXPECT(Drain(wav_s16) == std::vector<float>({0.0f, 0.5f, -0.5f, -1.0f}))
+  std::remove("audio_source_test_f32.wav");
+  std::remove("audio_source_test_s16.wav");
+
+  // pcm24 and float64 through the whole pipeline: 1 kHz at 0.5 on both
+  // channels reads the same as the float32 tone below
+  for (uint16_t bits : {24, 64}) {
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; i < 48000; i++) {
+      double v = 0.5 * std::sin(2.0 * 3.14159265358979323846 * 1000 * i /
+                                48000);
+      for (int c = 0; c < 2; c++) {
+        if (bits == 24) {
+          int32_t s = int32_t(std::lround(v * 8388607));
+          data.insert(data.end(), {uint8_t(s), uint8_t(s >> 8),
+                                   uint8_t(s >> 16)});
+        } else {
+          const uint8_t *p = (const uint8_t *)&v;
+          data.insert(data.end(), p, p + 8);
+        }
+      }
+    }
+    WriteWav("audio_source_test_native.wav", bits == 24 ? 1 : 3, 2, 48000,
+             bits, data.data(), uint32_t(data.size()));
+    AudioThread native(100, new WavFileSource("audio_source_test_native.wav",
+                                              441));
+    std::remove("audio_source_test_native.wav");
+    native.Start();
+    while (!native.IsFinished()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    native.Stop();
+    SpectrumView native_view = native.AcquireAmplitude();
+    EXPECT(native_view.frame_id == 100)
+    EXPECT(std::abs(native_view.data[10] - 0.5f) < 1e-3f)
+    EXPECT(native_view.data[20] < 1e-4f)
+  }
+
+  // event driven: 10 ms periods arrive one by one, not in 500 ms bursts
+  config.total_frames = 48000 / 4;
+  SimulatedEventSource event(new ToneSource(config), config.packet_frames);
+  uint64_t event_frames = 0;
+  auto last = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration max_gap{};
+  event.StartService();
+  while (!event.IsExhausted()) {
+    event.GetBuffer([] { return false; }, [&](uint8_t *, uint32_t frame_len) {
+      auto now = std::chrono::steady_clock::now();
+      max_gap = std::max(max_gap, now - last);
+      last = now;
+      event_frames += frame_len;
+    });
+  }
+  event.StopService();
+  EXPECT(event_frames == config.total_frames)
+  EXPECT(event.GetOverruns() == 0)
+  EXPECT(max_gap < std::chrono::milliseconds(50))
+
+  // packets that do not match the period are regrouped, nothing is lost
+  {
+    ToneConfig uneven = config;
+    uneven.packet_frames = 700;
+    uneven.total_frames = 4800;
+    ToneSource reference_source(uneven);
+    std::vector<float> reference = Drain(reference_source);
+    SimulatedEventSource regrouped(new ToneSource(uneven), 256);
+    std::vector<float> delivered;
+    bool oversized = false;
+    regrouped.StartService();
+    while (!regrouped.IsExhausted()) {
+      regrouped.GetBuffer([] { return false; },
+                          [&](uint8_t *data, uint32_t frame_len) {
+                            oversized |= frame_len > 256;
+                            const float *f = (const float *)data;
+                            delivered.insert(delivered.end(), f,
+                                             f + frame_len * 2);
+                          });
+    }
+    regrouped.StopService();
+    EXPECT(!oversized)
+    EXPECT(delivered == reference)
+    EXPECT(regrouped.GetOverruns() == 0)
+  }
+
+  // whole pipeline, faster than real time: 1 kHz lands in bin 10 at 100 Hz gap
+  config.noise = 0.0f;
+  config.total_frames = 48000;
+  AudioThread w(100, new ToneSource(config));
+  w.Start();
+  while (!w.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  w.Stop();
+  // nobody read while it ran: the first frames are kept, the rest dropped
+  const AudioFrame *frame = w.ReadFrame();
+  EXPECT(frame != nullptr && frame->seq == 1 && frame->sample_pos == 480)
+  EXPECT(w.GetDroppedFrames() == 100 - 16)
+  // ...while the spectrum view always has the newest one
+  SpectrumView view = w.AcquireAmplitude();
+  EXPECT(view.frame_id == 100 && view.sample_pos == 48000)
+  EXPECT(w.AcquireAmplitude().data == view.data)
+  std::vector<float> amplitude(w.GetAmplitudeLen()), freqs(amplitude.size());
+  w.GetAmplitude(amplitude.data());
+  w.GetFreqRange(freqs.data());
+  size_t peak = 0;
+  for (size_t i = 1; i < amplitude.size(); i++) {
+    peak = amplitude[i] > amplitude[peak] ? i : peak;
+  }
+  EXPECT(freqs[peak] == 1000.0f)
+  EXPECT(std::abs(amplitude[peak] - 0.5f) < 1e-3f)
+
+  // each frame's raws are the window's samples, oldest first, also when
+  // the overlap makes windows start halfway through the ring
+  {
+    ToneConfig short_tone = config;
+    short_tone.total_frames = 4800;
+    ToneSource reference_source(short_tone);
+    std::vector<float> reference = Drain(reference_source);
+    AnalysisConfig overlapped;
+    overlapped.overlap = 0.5f;
+    AudioThread ot(overlapped, new ToneSource(short_tone));
+    ot.Start();
+    while (!ot.IsFinished()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ot.Stop();
+    const uint32_t raw_len = ot.GetRawLen();
+    EXPECT(raw_len == 480)
+    // AcquireRaw and GetRaw have the newest window and leave the queued
+    // frames alone
+    RawView raw = ot.AcquireRaw();
+    EXPECT(raw.len == raw_len && raw.channels == 2)
+    EXPECT(raw.frame_id == ot.AcquireAmplitude().frame_id)
+    EXPECT(raw.sample_pos == 4800)
+    for (uint32_t i = 0; i < raw_len; i++) {
+      EXPECT(raw.data[raw_len + i] == reference[(4800 - raw_len + i) * 2 + 1])
+    }
+    std::vector<float> newest(raw_len);
+    for (uint16_t c = 0; c < 2; c++) {
+      ot.GetRaw(newest.data(), c);
+      for (uint32_t i = 0; i < raw_len; i++) {
+        EXPECT(newest[i] == reference[(4800 - raw_len + i) * 2 + c])
+      }
+    }
+    uint32_t read = 0;
+    for (const AudioFrame *f; (f = ot.ReadFrame()) != nullptr; read++) {
+      // the first window is due after one hop, silence before the signal
+      EXPECT(f->sample_pos == 240 * (read + 1))
+      for (uint16_t c = 0; c < 2; c++) {
+        for (uint32_t i = 0; i < raw_len; i++) {
+          int64_t frame = int64_t(f->sample_pos) - raw_len + i;
+          float expected = frame < 0 ? 0.0f : reference[frame * 2 + c];
+          EXPECT(f->raws[c * raw_len + i] == expected)
+        }
+      }
+      ot.ReleaseFrame();
+    }
+    EXPECT(read == 16)
+  }
+
+  // AcquireRaw polled while capture runs: every window it hands out is
+  // whole and the one its frame id and position say
+  {
+    ToneConfig noisy = config;
+    noisy.noise = 0.1f;
+    noisy.total_frames = 48000 * 4;
+    ToneSource reference_source(noisy);
+    std::vector<float> reference = Drain(reference_source);
+    AnalysisConfig overlapped;
+    overlapped.overlap = 0.5f;
+    AudioThread nt(overlapped, new ToneSource(noisy));
+    const uint32_t raw_len = nt.GetRawLen();
+    uint64_t last_id = 0, views = 0;
+    bool whole = true;
+    nt.Start();
+    for (bool done = false; !done;) {
+      done = nt.IsFinished();
+      RawView raw = nt.AcquireRaw();
+      if (raw.frame_id == last_id) {
+        continue;
+      }
+      last_id = raw.frame_id;
+      views++;
+      whole &= raw.sample_pos == 240 * raw.frame_id;
+      for (uint16_t c = 0; c < 2; c++) {
+        for (uint32_t i = 0; i < raw_len; i++) {
+          int64_t frame = int64_t(raw.sample_pos) - raw_len + i;
+          float expected = frame < 0 ? 0.0f : reference[frame * 2 + c];
+          whole &= raw.data[c * raw_len + i] == expected;
+        }
+      }
+    }
+    nt.Stop();
+    EXPECT(whole)
+    EXPECT(views > 0 && last_id == 48000 * 4 / 240)
+  }
+
+  // identical channels: all in the mid spectrum, nothing in the side one
+  AnalysisConfig mid_side;
+  mid_side.channel_mode = ChannelMode::kMidSide;
+  AudioThread ms(mid_side, new ToneSource(config));
+  EXPECT(ms.GetSpectrumCount() == 2)
+  ms.Start();
+  while (!ms.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ms.Stop();
+  std::vector<float> side(ms.GetAmplitudeLen());
+  ms.GetAmplitude(amplitude.data(), 0);
+  ms.GetAmplitude(side.data(), 1);
+  EXPECT(std::abs(amplitude[peak] - 0.5f) < 1e-3f)
+  EXPECT(*std::max_element(side.begin(), side.end()) == 0.0f)
+
+  // third octave bands in dBFS: 31 values instead of 241 bins, the tone
+  // at its level in the 1 kHz band
+  AnalysisConfig banded;
+  banded.bands = BandScale::kThirdOctave;
+  banded.scale = SpectrumScale::kDecibels;
+  AudioThread bt(banded, new ToneSource(config));
+  EXPECT(bt.GetAmplitudeLen() == 31)
+  bt.Start();
+  while (!bt.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bt.Stop();
+  std::vector<float> band_db(31), centres(31);
+  bt.GetAmplitude(band_db.data());
+  bt.GetFreqRange(centres.data());
+  EXPECT(centres[17] == 1000.0f)
+  EXPECT(std::abs(band_db[17] - 20 * std::log10(0.5f)) < 1e-2f)
+  EXPECT(band_db[10] < -100.0f)
+
+  // constant-Q semitones from 250 Hz: the tone two octaves up
+  AnalysisConfig cq_config;
+  cq_config.constant_q = ConstantQConfig{250.0f, 8000.0f};
+  AudioThread cq(cq_config, new ToneSource(config));
+  EXPECT(cq.GetAmplitudeLen() == 61)
+  cq.Start();
+  while (!cq.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  cq.Stop();
+  std::vector<float> notes(61), note_freqs(61);
+  cq.GetAmplitude(notes.data());
+  cq.GetFreqRange(note_freqs.data());
+  EXPECT(std::abs(note_freqs[24] - 1000.0f) < 1e-2f)
+  EXPECT(std::abs(notes[24] - 0.5f) < 0.02f)
+  EXPECT(notes[21] < 0.05f)
+
+  // smoothed and peak held: a steady tone reads the same, the peaks sit
+  // on top of it
+  EXPECT(w.AcquireAmplitude().peak == nullptr)
+  AnalysisConfig smooth;
+  smooth.smoothing.average = 3;
+  smooth.smoothing.release = 0.2f;
+  smooth.smoothing.peaks = true;
+  AudioThread st(smooth, new ToneSource(config));
+  st.Start();
+  while (!st.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  st.Stop();
+  SpectrumView smoothed = st.AcquireAmplitude();
+  EXPECT(smoothed.peak != nullptr)
+  EXPECT(std::abs(smoothed.data[peak] - 0.5f) < 1e-3f)
+  EXPECT(smoothed.peak[peak] >= smoothed.data[peak])
+
+  // a second, longer resolution from the same capture
+  AnalysisConfig multi;
+  multi.resolutions.push_back({4800, 2400});
+  AudioThread mt(multi, new ToneSource(config));
+  EXPECT(mt.GetResolutionCount() == 2)
+  mt.Start();
+  while (!mt.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  mt.Stop();
+  SpectrumView fine = mt.AcquireAmplitude(1);
+  // half the 480 frame hop of resolution 0 late
+  EXPECT(fine.len == 2401 && fine.frame_id == (48000 - 240) / 2400)
+  std::vector<float> fine_freqs(fine.len);
+  mt.GetFreqRange(fine_freqs.data(), 1);
+  EXPECT(fine_freqs[100] == 1000.0f)
+  EXPECT(std::abs(fine.data[100] - 0.5f) < 1e-3f)
+  EXPECT(mt.AcquireAmplitude(0).len == 241)
+
+  // capture and analysis on two threads: with room for every packet the
+  // worker computes exactly what a single thread does
+  AnalysisConfig piped;
+  piped.overlap = 0.5f;
+  piped.pipeline = PipelineConfig{128, 1024, Backpressure::kDropOldest};
+  AnalysisConfig unpiped = piped;
+  unpiped.pipeline.reset();
+  AudioThread pt(piped, new ToneSource(config)),
+      ut(unpiped, new ToneSource(config));
+  for (AudioThread *t : {&pt, &ut}) {
+    t->Start();
+    while (!t->IsFinished()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    t->Stop();
+  }
+  SpectrumView piped_view = pt.AcquireAmplitude(),
+               unpiped_view = ut.AcquireAmplitude();
+  EXPECT(piped_view.frame_id == unpiped_view.frame_id)
+  EXPECT(std::equal(piped_view.data, piped_view.data + piped_view.len,
+                    unpiped_view.data))
+  PipelineStats stats = pt.GetPipelineStats();
+  EXPECT(stats.blocks == 100 && stats.dropped_frames == 0)
+  EXPECT(ut.GetPipelineStats().blocks == 0)
+
+  // coalescing skips spectra of a backlog, never the newest one
+  piped.pipeline->backpressure = Backpressure::kCoalesce;
+  AudioThread ct(piped, new ToneSource(config));
+  ct.Start();
+  while (!ct.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ct.Stop();
+  SpectrumView coalesced = ct.AcquireAmplitude();
+  EXPECT(coalesced.frame_id == unpiped_view.frame_id)
+  EXPECT(std::abs(coalesced.data[peak] - 0.5f) < 1e-3f)
+  EXPECT(ct.GetPipelineStats().dropped_frames == 0)
+
+  // several analyzers sharing a two thread pool instead of a worker each
+  {
+    TaskPool pool(2);
+    AnalysisConfig pooled = unpiped;
+    pooled.pool = &pool;
+    std::vector<AudioThread *> streams;
+    for (int i = 0; i < 4; i++) {
+      streams.push_back(new AudioThread(pooled, new ToneSource(config)));
+      streams.back()->Start();
+    }
+    for (AudioThread *t : streams) {
+      while (!t->IsFinished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      t->Stop();
+      SpectrumView view = t->AcquireAmplitude();
+      EXPECT(view.frame_id == unpiped_view.frame_id)
+      EXPECT(std::equal(view.data, view.data + view.len, unpiped_view.data))
+      EXPECT(t->GetPipelineStats().dropped_frames == 0)
+      delete t;
+    }
+  }
+
+  // audio lost to a full pipeline: positions stay on the capture clock,
+  // the frame ids skip one and no window straddles the gap. The pool's
+  // only thread is held, so capture drops all but the last four blocks.
+  {
+    PoolHold hold;
+    TaskPool pool(1);
+    TaskPool::StreamId busy = pool.Register(&PoolHold::Job, &hold);
+    pool.Signal(busy);
+    while (!hold.entered) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    AnalysisConfig lossy = unpiped;
+    lossy.pipeline = PipelineConfig{4, 1024, Backpressure::kDropOldest};
+    lossy.pool = &pool;
+    AudioThread lt(lossy, new ToneSource(config));
+    lt.Start();
+    while (lt.GetPipelineStats().blocks < 100) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    lt.Stop(); // analyses the four blocks left
+    hold.release = true;
+    pool.Unregister(busy);
+    PipelineStats lost = lt.GetPipelineStats();
+    EXPECT(lost.dropped_blocks == 96 && lost.dropped_frames == 96 * 480)
+    // the first window after the gap ends one hop into the kept audio
+    const AudioFrame *first = lt.ReadFrame();
+    EXPECT(first && first->seq == 2 && first->sample_pos == 96 * 480 + 240)
+    SpectrumView view = lt.AcquireAmplitude();
+    EXPECT(view.frame_id == 2 + 4 * 480 / 240 - 1)
+    EXPECT(view.sample_pos == 48000)
+    EXPECT(std::equal(view.data, view.data + view.len, unpiped_view.data))
+  }
+
+  // a backlog under kCoalesce: the worker catching up skips the windows
+  // of all but the newest block, counts them, and the ids show the skip
+  {
+    PoolHold hold;
+    TaskPool pool(1);
+    TaskPool::StreamId busy = pool.Register(&PoolHold::Job, &hold);
+    pool.Signal(busy);
+    while (!hold.entered) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    AnalysisConfig behind = unpiped;
+    behind.pipeline = PipelineConfig{4, 1024, Backpressure::kCoalesce};
+    behind.pool = &pool;
+    GatedTone *gated = new GatedTone(config, config, 0);
+    AudioThread bt(behind, gated);
+    bt.Start();
+    gated->Allow(4);
+    while (bt.GetPipelineStats().blocks < 4) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    hold.release = true;
+    while (bt.AcquireAmplitude().frame_id < 8) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bt.Stop();
+    pool.Unregister(busy);
+    PipelineStats backlog = bt.GetPipelineStats();
+    EXPECT(backlog.dropped_blocks == 0 && backlog.coalesced_windows == 6)
+    const AudioFrame *first = bt.ReadFrame();
+    EXPECT(first && first->seq == 7)
+  }
+
+  // smoothing starts over after a gap as well: a loud tone analysed before
+  // the loss leaves no held peak on the quiet one after it
+  {
+    PoolHold hold;
+    TaskPool pool(1);
+    TaskPool::StreamId busy = pool.Register(&PoolHold::Job, &hold);
+    AnalysisConfig held = unpiped;
+    held.smoothing.peaks = true;
+    held.smoothing.peak_hold = 10.0f;
+    held.pipeline = PipelineConfig{4, 1024, Backpressure::kDropOldest};
+    held.pool = &pool;
+    ToneConfig loud = config, quiet = config;
+    loud.total_frames = quiet.total_frames = 0;
+    quiet.amplitude = 0.1f;
+    GatedTone *gated = new GatedTone(loud, quiet, 10);
+    AudioThread gt(held, gated);
+    gt.Start();
+    for (uint64_t p = 1; p <= 10; p++) {
+      gated->Allow(1); // each analysed before the next, two windows each
+      while (gt.AcquireAmplitude().frame_id < 2 * p) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    pool.Signal(busy);
+    while (!hold.entered) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    gated->Allow(20); // all but the last four blocks lost
+    while (gt.GetPipelineStats().blocks < 30) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    hold.release = true;
+    // one id skipped, then two windows per kept block
+    while (gt.AcquireAmplitude().frame_id < 21 + 4 * 2) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    gt.Stop();
+    pool.Unregister(busy);
+    EXPECT(gt.GetPipelineStats().dropped_blocks == 16)
+    SpectrumView view = gt.AcquireAmplitude();
+    EXPECT(view.frame_id == 29 && view.peak != nullptr)
+    EXPECT(std::abs(view.data[peak] - 0.1f) < 1e-3f)
+    EXPECT(std::abs(view.peak[peak] - 0.1f) < 1e-3f)
+  }
+
+  // bands and constant-Q bins are two answers to one question
+  cq_config.bands = BandScale::kMel;
+  bool thrown = false;
+  try {
+    AudioThread both(cq_config, new ToneSource(config));
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  EXPECT(thrown)
+
+  // a bin spacing of 0 or past Nyquist leaves no window; the rejected
+  // source is still deleted
+  for (uint32_t hz_gap : {0u, config.sample_rate}) {
+    thrown = false;
+    try {
+      AudioThread gapless(hz_gap, new CountedTone(config));
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    EXPECT(thrown)
+  }
+  EXPECT(CountedTone::deleted == 2)
+
+  std::cout << "audio_source_test passed\n";
+  return 0;
+}
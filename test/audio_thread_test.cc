@@ -1,4 +1,5 @@
 #include "audio_thread.h"
+#include "tone_source.hpp"
 #include <iostream>
 #include <thread>
 
@@ -13,7 +14,14 @@
 int main(int argc, char *argv[]) {
   std::cout << "Start main...\n";
 
+#ifdef _WIN32
   AudioThread w(100);
+#else
+  ToneConfig config;
+  config.freqs = {440.0f, 2000.0f};
+  config.realtime = true;
+  AudioThread w(100, new ToneSource(config));
+#endif
   std::vector<float> data;
   w.Start();
 
@@ -0,0 +1,82 @@
+#include "band_mapper.hpp"
+#include "expect.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+static std::vector<float> Freqs(uint32_t sample_rate, uint32_t nfft) {
+  std::vector<float> freqs(nfft / 2 + 1);
+  for (uint32_t i = 0; i < freqs.size(); i++) {
+    freqs[i] = i * sample_rate / float(nfft);
+  }
+  return freqs;
+}
+
+int main() {
+  // 48 kHz, 4096 point fft: 2049 bins 11.7 Hz apart
+  std::vector<float> freqs = Freqs(48000, 4096);
+  const uint32_t bins = uint32_t(freqs.size());
+
+  // 31 third octaves from 20 Hz to 20 kHz, 1 kHz among them
+  BandMapper third(BandScale::kThirdOctave, freqs.data(), bins);
+  EXPECT(third.GetBandCount() == 31)
+  std::vector<float> centres(third.GetBandCount());
+  third.GetCenters(centres.data());
+  EXPECT(centres[17] == 1000.0f)
+  // every weight is needed: about one per bin, far from bins * bands
+  EXPECT(third.GetWeightCount() < bins + third.GetBandCount())
+
+  // a bin inside one band lands there whole
+  std::vector<float> power(bins, 0.0f), bands(third.GetBandCount());
+  power[85] = 1.0f; // 996 Hz
+  third.Apply(power.data(), bands.data());
+  for (uint32_t b = 0; b < bands.size(); b++) {
+    EXPECT(bands[b] == (b == 17 ? 1.0f : 0.0f))
+  }
+  // ...and in dB: a 0.5 amplitude sine is 0.25 power, -6.02 dBFS
+  power[85] = 0.25f;
+  third.Apply(power.data(), bands.data(), 1.0f, SpectrumScale::kDecibels);
+  EXPECT(std::abs(bands[17] - 20 * std::log10(0.5f)) < 1e-4f)
+  EXPECT(bands[16] == kDecibelFloor)
+
+  // overlapping mel triangles still count every bin once between the
+  // first and last centre
+  BandMapper mel(BandScale::kMel, freqs.data(), bins, 40);
+  EXPECT(mel.GetBandCount() == 40)
+  std::vector<float> mel_centres(40), mel_bands(40);
+  mel.GetCenters(mel_centres.data());
+  bool partition = true;
+  for (uint32_t k = 0; k < bins; k += 7) {
+    if (freqs[k] < mel_centres[0] || freqs[k] > mel_centres[39]) {
+      continue;
+    }
+    std::fill(power.begin(), power.end(), 0.0f);
+    power[k] = 1.0f;
+    mel.Apply(power.data(), mel_bands.data());
+    float sum = 0.0f;
+    for (float v : mel_bands) {
+      sum += v;
+    }
+    partition &= std::abs(sum - 1.0f) < 1e-5f;
+  }
+  EXPECT(partition)
+
+  // Bark: all 24 critical bands at 48 kHz, the ones below 8 kHz at 16 kHz
+  EXPECT(BandMapper(BandScale::kBark, freqs.data(), bins).GetBandCount() == 24)
+  std::vector<float> narrow = Freqs(16000, 512);
+  BandMapper bark(BandScale::kBark, narrow.data(), uint32_t(narrow.size()));
+  EXPECT(bark.GetBandCount() == 22)
+  // flat power: each band reads its width in bins, all of them the range
+  std::vector<float> flat(narrow.size(), 1.0f), bark_bands(22);
+  bark.Apply(flat.data(), bark_bands.data());
+  float total = 0.0f;
+  for (float v : bark_bands) {
+    total += v;
+  }
+  EXPECT(std::abs(bark_bands[0] - 100 / 31.25f) < 1e-4f)
+  EXPECT(std::abs(total - 8000 / 31.25f) < 1e-3f)
+
+  std::cout << "band_mapper_test passed\n";
+  return 0;
+}
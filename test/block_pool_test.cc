@@ -0,0 +1,75 @@
+#include "block_pool.hpp"
+#include "expect.h"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main() {
+  // every block on its own cache lines, handed out once until released
+  {
+    BlockPool pool(100, 4);
+    EXPECT(pool.GetCount() == 4 && pool.GetBlockBytes() == 100)
+    std::vector<BlockPool::Handle> held(4);
+    for (BlockPool::Handle &h : held) {
+      EXPECT(pool.Acquire(h))
+      EXPECT(uintptr_t(pool.Data(h)) % BlockPool::kAlign == 0)
+    }
+    BlockPool::Handle none;
+    EXPECT(!pool.Acquire(none))
+    EXPECT(pool.Available() == 0)
+    for (int i = 0; i < 4; i++) {
+      for (int j = i + 1; j < 4; j++) {
+        EXPECT(held[i] != held[j])
+        EXPECT(pool.Data(held[i]) + 128 <= pool.Data(held[j]) ||
+               pool.Data(held[j]) + 128 <= pool.Data(held[i]))
+      }
+    }
+    pool.Release(held[2]);
+    BlockPool::Handle again;
+    EXPECT(pool.Acquire(again) && again == held[2])
+    EXPECT(pool.Available() == 0)
+  }
+
+  // four threads acquiring and releasing at once never share a block
+  {
+    BlockPool pool(sizeof(uint32_t), 8);
+    std::atomic<bool> shared(false);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; t++) {
+      threads.emplace_back([&, t] {
+        for (uint32_t i = 0; i < 100000; i++) {
+          BlockPool::Handle h;
+          if (!pool.Acquire(h)) {
+            continue;
+          }
+          uint32_t mark = t * 100000 + i;
+          std::memcpy(pool.Data(h), &mark, sizeof(mark));
+          std::this_thread::yield();
+          uint32_t read;
+          std::memcpy(&read, pool.Data(h), sizeof(read));
+          if (read != mark) {
+            shared = true;
+          }
+          pool.Release(h);
+        }
+      });
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+    EXPECT(!shared)
+    EXPECT(pool.Available() == 8)
+    std::vector<BlockPool::Handle> all(8);
+    for (BlockPool::Handle &h : all) {
+      EXPECT(pool.Acquire(h))
+    }
+    BlockPool::Handle none;
+    EXPECT(!pool.Acquire(none))
+  }
+
+  std::cout << "block_pool_test passed\n";
+  return 0;
+}
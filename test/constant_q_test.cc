@@ -0,0 +1,83 @@
+#include "constant_q.hpp"
+#include "expect.h"
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// the split spectrum AudioFFT hands ConstantQ, without a window
+static void Spectrum(const std::vector<float> &signal, std::vector<float> &re,
+                     std::vector<float> &im) {
+  auto plan = GetFftPlan(FftLayout::kReal, uint32_t(signal.size()));
+  std::vector<kiss_fft_cpx> scratch(plan->GetScratchLen());
+  re.resize(signal.size() / 2 + 1);
+  im.resize(re.size());
+  kiss_fftr_split_scratch(plan->Real(), signal.data(), re.data(), im.data(),
+                          scratch.data());
+}
+
+int main() {
+  const uint32_t rate = 48000;
+  const float pi = 3.14159265f;
+  ConstantQConfig config; // semitones from A1 = 55 Hz
+
+  // Q = 16.8 cycles of 55 Hz need 14680 samples
+  EXPECT(ConstantQ::FftLen(config, rate) == 16384)
+  ConstantQ cq(config, rate);
+  const uint32_t nfft = cq.GetFftLen();
+  EXPECT(nfft == 16384)
+  std::vector<float> centres(cq.GetBinCount());
+  cq.GetCenters(centres.data());
+  EXPECT(std::abs(centres[24] - 220.0f) < 1e-3f)   // A3
+  EXPECT(centres.back() * std::pow(2.0f, 1 / 24.0f) <= rate / 2.0f)
+  EXPECT(cq.GetBinCount() == 105) // up to 55 * 2^(104 / 12) Hz
+
+  // sparse: short high kernels spread over a few hundred fft bins, low
+  // ones over a handful, against nfft / 2 + 1 each for a dense matrix
+  const size_t dense = size_t(cq.GetBinCount()) * (nfft / 2 + 1);
+  EXPECT(cq.GetWeightCount() * 20 < dense)
+  ConstantQConfig coarse = config;
+  coarse.threshold = 0.1f;
+  EXPECT(ConstantQ(coarse, rate).GetWeightCount() < cq.GetWeightCount())
+
+  // a sine on a bin centre reads its amplitude there, two bins away next
+  // to nothing
+  std::vector<float> signal(nfft), re, im, bins(cq.GetBinCount());
+  for (uint32_t n = 0; n < nfft; n++) {
+    signal[n] = 0.5f * std::cos(2 * pi * 220.0f * n / rate);
+  }
+  Spectrum(signal, re, im);
+  cq.Apply(re.data(), im.data(), bins.data());
+  EXPECT(std::abs(bins[24] - 0.5f) < 0.02f)
+  EXPECT(bins[22] < 0.05f && bins[26] < 0.05f)
+
+  // kernels end at the newest sample: a high note only in the last 1000
+  // samples is fully there for its 229 sample kernel
+  std::fill(signal.begin(), signal.end(), 0.0f);
+  for (uint32_t n = nfft - 1000; n < nfft; n++) {
+    signal[n] = 0.25f * std::cos(2 * pi * 3520.0f * n / rate);
+  }
+  Spectrum(signal, re, im);
+  cq.Apply(re.data(), im.data(), bins.data(), SpectrumScale::kDecibels);
+  EXPECT(std::abs(bins[72] - 20 * std::log10(0.25f)) < 0.2f)
+  EXPECT(bins[24] < -40.0f)
+
+  // configs without bins are refused
+  ConstantQConfig flat = config, dc = config, above = config;
+  flat.bins_per_octave = 0;
+  dc.min_hz = 0.0f;
+  above.max_hz = rate / 2.0f + 1.0f;
+  for (const ConstantQConfig &bad : {flat, dc, above}) {
+    bool thrown = false;
+    try {
+      ConstantQ refused(bad, rate);
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    EXPECT(thrown)
+  }
+
+  std::cout << "constant_q_test passed\n";
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include "dsp_kernels.h"
+#include "expect.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+int main() {
+  std::cout << "cpu kernels: " << KernelIsaName(DetectKernelIsa()) << '\n';
+
+  // every isa against plain arithmetic, odd lengths to hit the tails
+  const uint32_t frames = 1027;
+  for (KernelIsa isa :
+       {KernelIsa::kScalar, KernelIsa::kSse2, KernelIsa::kAvx2}) {
+    for (uint16_t channels : {1, 2, 3, 6, 8, 12}) {
+      std::vector<float> src(frames * channels);
+      for (size_t i = 0; i < src.size(); i++) {
+        src[i] = std::sin(0.37f * i) + 0.01f * (i % 13);
+      }
+      std::vector<std::vector<float>> planar(channels,
+                                             std::vector<float>(frames, -9));
+      std::vector<float *> planar_ptr;
+      for (auto &p : planar) {
+        planar_ptr.push_back(p.data());
+      }
+      std::vector<float> mono(frames, -9), mono_only(frames, -9);
+
+      DeinterleaveFn deinterleave = GetDeinterleave(channels, isa);
+      deinterleave(src.data(), frames, channels, planar_ptr.data(),
+                   mono.data());
+      deinterleave(src.data(), frames, channels, nullptr, mono_only.data());
+
+      bool planar_ok = true, mono_ok = true;
+      for (uint32_t i = 0; i < frames; i++) {
+        float sum = 0;
+        for (uint16_t c = 0; c < channels; c++) {
+          planar_ok &= planar[c][i] == src[i * channels + c];
+          sum += src[i * channels + c];
+        }
+        mono_ok &= std::abs(mono[i] - sum / channels) < 1e-6f;
+        mono_ok &= mono_only[i] == mono[i];
+      }
+      EXPECT(planar_ok)
+      EXPECT(mono_ok)
+    }
+
+    std::vector<float> a(frames), w(frames), out(frames);
+    for (uint32_t i = 0; i < frames; i++) {
+      a[i] = 0.5f * i;
+      w[i] = 1.0f / (i + 1);
+    }
+    GetMulWindow(isa)(a.data(), w.data(), out.data(), frames);
+    bool window_ok = true;
+    for (uint32_t i = 0; i < frames; i++) {
+      window_ok &= out[i] == a[i] * w[i];
+    }
+    EXPECT(window_ok)
+
+    std::vector<float> magnitude(frames), magnitude_ref(frames);
+    GetMagnitude(isa)(a.data(), w.data(), 0.25f, magnitude.data(), frames);
+    GetMagnitude(KernelIsa::kScalar)(a.data(), w.data(), 0.25f,
+                                     magnitude_ref.data(), frames);
+    EXPECT(magnitude == magnitude_ref)
+    EXPECT(std::abs(magnitude[3] - std::hypot(a[3], w[3]) / 4) < 1e-6f)
+
+    // power and dB: same bits as scalar, dB near log10 down to the floor
+    for (SpectrumScale scale :
+         {SpectrumScale::kPower, SpectrumScale::kDecibels}) {
+      std::vector<float> out(frames), out_ref(frames);
+      GetSpectrum(scale, isa)(a.data(), w.data(), 0.25f, out.data(), frames);
+      GetSpectrum(scale, KernelIsa::kScalar)(a.data(), w.data(), 0.25f,
+                                            out_ref.data(), frames);
+      EXPECT(out == out_ref)
+    }
+    std::vector<float> db_re(2000), db_im(2000, 0.0f), db(2000);
+    for (uint32_t i = 0; i < db_re.size(); i++) {
+      db_re[i] = std::pow(10.0f, -7.0f + 0.0045f * i) * (i % 2 ? -1 : 1);
+    }
+    db_re[0] = 0.0f;
+    GetSpectrum(SpectrumScale::kDecibels, isa)(db_re.data(), db_im.data(),
+                                               1.0f, db.data(), 2000);
+    double db_err = 0.0;
+    for (uint32_t i = 0; i < db.size(); i++) {
+      double ref = std::max(20 * std::log10(std::abs((double)db_re[i])),
+                            (double)kDecibelFloor);
+      db_err = std::max(db_err, std::abs(db[i] - ref));
+    }
+    EXPECT(db[0] == kDecibelFloor && db[1] == kDecibelFloor)
+    EXPECT(db_err < 1e-4)
+    // the same from powers, in place
+    std::vector<float> power_db(2000);
+    for (uint32_t i = 0; i < power_db.size(); i++) {
+      power_db[i] = db_re[i] * db_re[i];
+    }
+    GetDecibels(isa)(power_db.data(), power_db.data(), 2000);
+    EXPECT(power_db == db)
+
+    // sample conversion: full scale ends, then every isa against scalar
+    int16_t s16[] = {0, 16384, -16384, -32768, 32767};
+    float f16[5];
+    GetConvert(SampleType::kInt16, isa)((const uint8_t *)s16, 5, f16);
+    EXPECT(f16[0] == 0.0f && f16[1] == 0.5f && f16[2] == -0.5f)
+    EXPECT(f16[3] == -1.0f && f16[4] == 32767 / 32768.0f)
+    uint8_t s24[] = {0x00, 0x00, 0x40, 0x00, 0x00, 0x80, 0xFF, 0xFF, 0x7F};
+    float f24[3];
+    GetConvert(SampleType::kInt24, isa)(s24, 3, f24);
+    EXPECT(f24[0] == 0.5f && f24[1] == -1.0f)
+    EXPECT(f24[2] == 8388607 / 8388608.0f)
+
+    // unaligned source; floats from sines, integers from arbitrary bytes
+    const uint32_t samples = 1031;
+    std::vector<uint8_t> ints(samples * 4), f32(samples * 4), f64(samples * 8);
+    for (uint32_t i = 0; i < samples; i++) {
+      float f = std::sin(0.1f * i);
+      double d = std::sin(0.1 * i);
+      std::memcpy(f32.data() + 4 * i, &f, 4);
+      std::memcpy(f64.data() + 8 * i, &d, 8);
+      for (int b = 0; b < 4; b++) {
+        ints[4 * i + b] = uint8_t(i * 131 + b * 37);
+      }
+    }
+    for (SampleType type :
+         {SampleType::kFloat32, SampleType::kFloat64, SampleType::kInt16,
+          SampleType::kInt24, SampleType::kInt32}) {
+      const std::vector<uint8_t> &data = type == SampleType::kFloat64 ? f64
+                                         : type == SampleType::kFloat32
+                                             ? f32
+                                             : ints;
+      std::vector<uint8_t> src(data.size() + 1);
+      std::copy(data.begin(), data.end(), src.begin() + 1);
+      std::vector<float> out(samples, -9), ref(samples, -7);
+      GetConvert(type, isa)(src.data() + 1, samples, out.data());
+      GetConvert(type, KernelIsa::kScalar)(src.data() + 1, samples,
+                                           ref.data());
+      EXPECT(out == ref)
+    }
+    EXPECT(GetConvert(SampleType::kUnsupported, isa) == nullptr)
+
+    // smoothing state evolves the same on every isa, frame after frame
+    const uint32_t bins = 1027;
+    SmoothParams params{1.0f / 3, 0.6f, 0.1f, 2.0f, 0.05f};
+    std::vector<std::vector<float>> state(10, std::vector<float>(bins, 0));
+    auto make_state = [&](int first) {
+      return SmoothState{state[first].data(), state[first + 1].data(),
+                         state[first + 2].data(), state[first + 3].data(),
+                         state[first + 4].data()};
+    };
+    SmoothState s = make_state(0), ref_s = make_state(5);
+    std::vector<float> x(bins), ref_x(bins), peaks(bins), ref_peaks(bins);
+    for (int frame = 0; frame < 12; frame++) {
+      for (uint32_t i = 0; i < bins; i++) {
+        x[i] = ref_x[i] = std::abs(std::sin(0.37f * i + 1.3f * frame));
+      }
+      s.oldest = state[1].data(), ref_s.oldest = state[6].data();
+      GetSmooth(isa)(x.data(), peaks.data(), bins, params, s);
+      GetSmooth(KernelIsa::kScalar)(ref_x.data(), ref_peaks.data(), bins,
+                                    params, ref_s);
+      EXPECT(x == ref_x)
+      EXPECT(peaks == ref_peaks)
+    }
+    for (int v = 0; v < 5; v++) {
+      EXPECT(state[v] == state[5 + v])
+    }
+  }
+
+  std::cout << "dsp_kernels_test passed\n";
+  return 0;
+}
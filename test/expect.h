@@ -0,0 +1,14 @@
+// Check macro of the test executables: report the failed condition and
+// return 1 from main (or whatever int function it is used in).
+#ifndef TEST_EXPECT_H
+#define TEST_EXPECT_H
+
+#include <iostream>
+
+#define EXPECT(cond)                                                           \
+  if (!(cond)) {                                                               \
+    std::cout << __FILE__ << ':' << __LINE__ << " FAILED: " #cond << '\n';     \
+    return 1;                                                                  \
+  }
+
+#endif
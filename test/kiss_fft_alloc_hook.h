@@ -0,0 +1,17 @@
+/* Force included into the libfft sources of kiss_fft_alloc_test, whose
+   KISS_FFT_MALLOC/KISS_FFT_FREE point at these counting functions. */
+#ifndef KISS_FFT_ALLOC_HOOK_H
+#define KISS_FFT_ALLOC_HOOK_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void *kiss_fft_test_malloc(size_t nbytes);
+void kiss_fft_test_free(void *ptr);
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#include "kiss_fft.h"
+#include "kiss_fftr.h"
+#include "expect.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// libfft is compiled into this test with KISS_FFT_MALLOC/KISS_FFT_FREE
+// pointing here, see test/CMakeLists.txt
+static size_t allocations = 0;
+
+extern "C" void *kiss_fft_test_malloc(size_t nbytes) {
+  allocations++;
+  return std::malloc(nbytes);
+}
+
+extern "C" void kiss_fft_test_free(void *ptr) { std::free(ptr); }
+
+// Transforms run in the capture callback: after the cfg is allocated they
+// must not touch the heap, whatever the radixes of the size.
+int main() {
+  // 882 is a 44100 / hz_gap window, kiss_fftr runs it as 441 = 3^2 7^2;
+  // 2002 = 2 7 11 13 has generic stages of different radix sharing one
+  // scratch, 2 * 1009 a prime one as large as the fft
+  for (int nfft : {2, 882, 1024, 2002, 2 * 1009}) {
+    size_t before = allocations;
+    kiss_fft_cfg fwd = kiss_fft_alloc(nfft, 0, nullptr, nullptr);
+    kiss_fftr_cfg fwd_r = kiss_fftr_alloc(nfft, 0, nullptr, nullptr);
+    EXPECT(allocations > before) // the hook is in place
+
+    std::vector<kiss_fft_cpx> in(nfft), out(nfft), out_r(nfft / 2 + 1);
+    std::vector<float> real(nfft), re(nfft / 2 + 1), im(re.size());
+    for (int i = 0; i < nfft; i++) {
+      in[i].r = std::sin(0.37f * i);
+      in[i].i = std::cos(0.11f * i);
+      real[i] = in[i].r;
+    }
+    before = allocations;
+    kiss_fft(fwd, in.data(), out.data());
+    kiss_fftr(fwd_r, real.data(), out_r.data());
+    kiss_fftr_split(fwd_r, real.data(), re.data(), im.data());
+    if (allocations != before) {
+      std::cout << "nfft " << nfft << '\n';
+    }
+    EXPECT(allocations == before)
+
+    // the shared scratch still gives a correct dft
+    double err = 0, mag = 0;
+    for (int k = 0; k < nfft; k += 5) {
+      double dre = 0, dim = 0;
+      for (int n = 0; n < nfft; n++) {
+        double phase = -2 * 3.14159265358979323846 * k * n / nfft;
+        dre += in[n].r * std::cos(phase) - in[n].i * std::sin(phase);
+        dim += in[n].r * std::sin(phase) + in[n].i * std::cos(phase);
+      }
+      err = std::max(err, std::hypot(dre - out[k].r, dim - out[k].i));
+      mag = std::max(mag, std::hypot(dre, dim));
+    }
+    EXPECT(err <= 1e-4 * (mag + 1))
+
+    kiss_fft_free(fwd);
+    kiss_fftr_free(fwd_r);
+  }
+
+  std::cout << "kiss_fft_alloc_test passed\n";
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include "kiss_fftr.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Time of one kiss_fftr per size for every simd level this CPU supports.
+int main() {
+  std::printf("%-7s %-6s %12s\n", "nfft", "level", "us/fft");
+  for (int nfft : {480, 1024, 4096, 16384, 65536}) {
+    std::vector<float> in(nfft);
+    for (int i = 0; i < nfft; i++) {
+      in[i] = std::sin(0.37f * i);
+    }
+    std::vector<kiss_fft_cpx> out(nfft / 2 + 1);
+    const int rounds = 20000000 / nfft + 10;
+    for (int level = 0; level <= 2; level++) {
+      kiss_fft_set_simd_level(level);
+      if (kiss_fft_simd_level() != level) {
+        continue;
+      }
+      kiss_fftr_cfg cfg = kiss_fftr_alloc(nfft, 0, nullptr, nullptr);
+      auto start = std::chrono::steady_clock::now();
+      for (int r = 0; r < rounds; r++) {
+        kiss_fftr(cfg, in.data(), out.data());
+      }
+      double sec = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+      kiss_fftr_free(cfg);
+      std::printf("%-7d %-6d %12.2f\n", nfft, level, sec / rounds * 1e6);
+    }
+  }
+  return 0;
+}
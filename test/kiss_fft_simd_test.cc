@@ -0,0 +1,80 @@
+#include "kiss_fft.h"
+#include "kiss_fftr.h"
+#include "expect.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Vector butterflies do the scalar code's arithmetic lane by lane, so every
+// simd level must give the scalar result exactly, split output included.
+int main() {
+  std::cout << "simd level: " << kiss_fft_simd_level() << '\n';
+  const int max_level = kiss_fft_simd_level();
+  // powers of 2 and 4, mixed radix, sizes with radix 2/4 stages of m not a
+  // multiple of the vector width, and odd half sizes for kiss_fftr
+  for (int nfft : {2, 4, 8, 32, 96, 128, 480, 882, 1000, 1024, 4096, 65536}) {
+    std::vector<kiss_fft_cpx> in(nfft);
+    std::vector<float> real(nfft);
+    for (int i = 0; i < nfft; i++) {
+      in[i].r = std::sin(0.37f * i) + 0.01f * (i % 13);
+      in[i].i = std::cos(0.11f * i);
+      real[i] = in[i].r;
+    }
+    std::vector<kiss_fft_cpx> ref(nfft), ref_inv(nfft), ref_r(nfft / 2 + 1);
+    for (int level = 0; level <= max_level; level++) {
+      kiss_fft_set_simd_level(level);
+      kiss_fft_cfg fwd = kiss_fft_alloc(nfft, 0, nullptr, nullptr);
+      kiss_fft_cfg inv = kiss_fft_alloc(nfft, 1, nullptr, nullptr);
+      kiss_fftr_cfg fwd_r = kiss_fftr_alloc(nfft, 0, nullptr, nullptr);
+      std::vector<kiss_fft_cpx> out(nfft), out_inv(nfft),
+          out_r(nfft / 2 + 1);
+      std::vector<float> re(nfft / 2 + 1), im(nfft / 2 + 1);
+      kiss_fft(fwd, in.data(), out.data());
+      kiss_fft(inv, in.data(), out_inv.data());
+      kiss_fftr(fwd_r, real.data(), out_r.data());
+      kiss_fftr_split(fwd_r, real.data(), re.data(), im.data());
+      bool split_same = true;
+      for (int i = 0; i <= nfft / 2; i++) {
+        split_same &= re[i] == out_r[i].r && im[i] == out_r[i].i;
+      }
+      EXPECT(split_same)
+      kiss_fft_free(fwd);
+      kiss_fft_free(inv);
+      kiss_fftr_free(fwd_r);
+      if (level == 0) {
+        ref = out, ref_inv = out_inv, ref_r = out_r;
+        continue;
+      }
+      bool same = true;
+      for (int i = 0; i < nfft; i++) {
+        same &= out[i].r == ref[i].r && out[i].i == ref[i].i;
+        same &= out_inv[i].r == ref_inv[i].r && out_inv[i].i == ref_inv[i].i;
+      }
+      for (int i = 0; i <= nfft / 2; i++) {
+        same &= out_r[i].r == ref_r[i].r && out_r[i].i == ref_r[i].i;
+      }
+      if (!same) {
+        std::cout << "nfft " << nfft << " level " << level << '\n';
+      }
+      EXPECT(same)
+    }
+    // and the scalar result is a correct dft
+    double err = 0, mag = 0;
+    for (int k = 0; k < nfft && nfft <= 1024; k += 7) {
+      double re = 0, im = 0;
+      for (int n = 0; n < nfft; n++) {
+        double phase = -2 * 3.14159265358979323846 * k * n / nfft;
+        re += in[n].r * std::cos(phase) - in[n].i * std::sin(phase);
+        im += in[n].r * std::sin(phase) + in[n].i * std::cos(phase);
+      }
+      err = std::max(err, std::hypot(re - ref[k].r, im - ref[k].i));
+      mag = std::max(mag, std::hypot(re, im));
+    }
+    EXPECT(err <= 1e-4 * (mag + 1))
+  }
+  kiss_fft_set_simd_level(2);
+
+  std::cout << "kiss_fft_simd_test passed\n";
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include "multi_resolution_fft.hpp"
+#include "expect.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+int main() {
+  AudioFormat format;
+  format.sample_rate = 48000;
+  format.channels = 2;
+  format.bits_per_sample = 32;
+  format.block_align = 8;
+  format.sample_type = SampleType::kFloat32;
+
+  // 1500 Hz sits on a bin of all three: 16, 128 and 1024
+  const uint32_t frames = 48000;
+  std::vector<float> interleaved(frames * 2);
+  for (uint32_t i = 0; i < frames; i++) {
+    interleaved[2 * i] = interleaved[2 * i + 1] =
+        0.5f * std::cos(2 * 3.14159265f * 1500.0f * i / 48000);
+  }
+
+  std::vector<ResolutionConfig> configs = {
+      {512, 256}, {4096, 1024}, {32768, 4096}};
+  MultiResolutionFFT multi(configs, format);
+  AudioFFT single(512, format, 256, WindowType::kHann);
+  EXPECT(multi.GetResolutionCount() == 3)
+  EXPECT(multi.GetOutputLen(2) == 16385)
+  EXPECT(multi.GetHop(1) == 1024)
+
+  std::vector<std::vector<float>> spectra(3);
+  std::vector<float *> dst;
+  for (uint32_t r = 0; r < 3; r++) {
+    spectra[r].resize(multi.GetOutputLen(r));
+    dst.push_back(spectra[r].data());
+  }
+  std::vector<float> reference(single.GetOutputLen());
+  uint32_t count[3] = {0, 0, 0};
+  bool single_due = true, same = true;
+  for (uint32_t pos = 0; pos < frames;) {
+    uint32_t n = std::min({480u, multi.FramesUntilReady(),
+                           multi.Contiguous(), frames - pos});
+    multi.Write(interleaved.data() + 2 * pos, n, nullptr);
+    uint32_t ready = multi.Commit(n, dst.data());
+    // staggered: never two resolutions on one frame
+    single_due &= (ready & (ready - 1)) == 0;
+    for (uint32_t r = 0; r < 3; r++) {
+      count[r] += (ready >> r) & 1;
+    }
+    // resolution 0 is exactly what an AudioFFT of its own computes
+    if (single.GetAmplitude(interleaved.data() + 2 * pos, n,
+                            reference.data()) != bool(ready & 1) ||
+        ((ready & 1) && reference != spectra[0])) {
+      same = false;
+    }
+    pos += n;
+  }
+  EXPECT(single_due)
+  EXPECT(same)
+  EXPECT(count[0] == 48000 / 256)
+  // the others start 1/3 and 2/3 of 256 frames late
+  EXPECT(count[1] == (48000 - 85) / 1024)
+  EXPECT(count[2] == (48000 - 170) / 4096)
+
+  // each reads the tone, in its own bin
+  EXPECT(std::abs(spectra[0][16] - 0.5f) < 1e-3f)
+  EXPECT(std::abs(spectra[1][128] - 0.5f) < 1e-3f)
+  EXPECT(std::abs(spectra[2][1024] - 0.5f) < 1e-3f)
+  std::vector<float> freqs(multi.GetOutputLen(2));
+  multi.GetFreqRange(2, freqs.data());
+  EXPECT(freqs[1024] == 1500.0f)
+
+  bool thrown = false;
+  try {
+    MultiResolutionFFT none({}, format);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  EXPECT(thrown)
+
+  std::cout << "multi_resolution_fft_test passed\n";
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include "packet_pipeline.hpp"
+#include "expect.h"
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// frames of one uint32_t, counting up from `first`
+static std::vector<uint32_t> Packet(uint32_t first, uint32_t frames) {
+  std::vector<uint32_t> packet(frames);
+  for (uint32_t i = 0; i < frames; i++) {
+    packet[i] = first + i;
+  }
+  return packet;
+}
+
+static uint32_t FirstFrame(const PacketPipeline::Block &block) {
+  return ((const uint32_t *)block.data)[0];
+}
+
+int main() {
+  PipelineConfig config;
+  config.blocks = 4;
+  config.block_frames = 1024;
+
+  // a packet larger than a block spreads over several, in order
+  {
+    PacketPipeline pipeline(config, 4);
+    std::vector<uint32_t> big = Packet(0, 2500);
+    pipeline.Push((const uint8_t *)big.data(), 2500);
+    EXPECT(pipeline.Backlog() == 3)
+    PacketPipeline::Block block;
+    for (uint32_t first : {0u, 1024u, 2048u}) {
+      EXPECT(pipeline.Pop(block))
+      EXPECT(FirstFrame(block) == first)
+      EXPECT(block.frames == (first == 2048 ? 452u : 1024u))
+      pipeline.Release(block);
+    }
+    EXPECT(!pipeline.Pop(block))
+  }
+
+  // a full pool gives up the oldest blocks, the newest audio stays
+  {
+    PacketPipeline pipeline(config, 4);
+    for (uint32_t p = 0; p < 6; p++) {
+      std::vector<uint32_t> packet = Packet(p * 100, 100);
+      pipeline.Push((const uint8_t *)packet.data(), 100);
+    }
+    PipelineStats stats = pipeline.GetStats();
+    EXPECT(stats.blocks == 6)
+    EXPECT(stats.dropped_blocks == 2 && stats.dropped_frames == 200)
+    EXPECT(stats.max_backlog == 4)
+    PacketPipeline::Block block;
+    std::vector<PacketPipeline::Block> held;
+    for (uint32_t first : {200u, 300u, 400u, 500u}) {
+      EXPECT(pipeline.Pop(block))
+      EXPECT(FirstFrame(block) == first && block.first_frame == first)
+      held.push_back(block);
+    }
+    // ...unless the worker holds them all: then the packet is lost
+    std::vector<uint32_t> packet = Packet(600, 100);
+    pipeline.Push((const uint8_t *)packet.data(), 100);
+    EXPECT(pipeline.GetStats().dropped_frames == 300)
+    EXPECT(!pipeline.Pop(block))
+    for (const PacketPipeline::Block &b : held) {
+      pipeline.Release(b);
+    }
+    pipeline.Push((const uint8_t *)packet.data(), 100);
+    // the lost packet still took its place on the capture clock
+    EXPECT(pipeline.Pop(block) && FirstFrame(block) == 600)
+    EXPECT(block.first_frame == 700)
+  }
+
+  // written in place: a commit queues what was written, nothing queues
+  // nothing, and with every block held the writes go nowhere
+  {
+    PacketPipeline pipeline(config, 4);
+    EXPECT(pipeline.GetBlockFrames() == 1024)
+    uint8_t *dst = pipeline.BeginPush();
+    std::vector<uint32_t> packet = Packet(7, 10);
+    std::memcpy(dst, packet.data(), 40);
+    pipeline.CommitPush(10);
+    pipeline.BeginPush();
+    pipeline.CommitPush(0);
+    EXPECT(pipeline.Backlog() == 1)
+    PacketPipeline::Block block;
+    EXPECT(pipeline.Pop(block) && FirstFrame(block) == 7 && block.frames == 10)
+    std::vector<PacketPipeline::Block> held = {block};
+    for (int i = 0; i < 3; i++) {
+      pipeline.Push((const uint8_t *)packet.data(), 10);
+      EXPECT(pipeline.Pop(block))
+      held.push_back(block);
+    }
+    std::memset(pipeline.BeginPush(), 0, 4096);
+    pipeline.CommitPush(1024);
+    EXPECT(pipeline.GetStats().dropped_frames == 1024)
+    EXPECT(!pipeline.Pop(block))
+    for (const PacketPipeline::Block &b : held) {
+      pipeline.Release(b);
+    }
+  }
+
+  // both sides at full speed: the worker sees whole blocks in order, and
+  // every frame is either analysed or counted as dropped
+  {
+    config.blocks = 8;
+    PacketPipeline pipeline(config, 4);
+    const uint32_t packets = 200000, frames = 64;
+    std::atomic<bool> done(false);
+    uint64_t analysed = 0;
+    bool in_order = true;
+    std::thread worker([&] {
+      PacketPipeline::Block block;
+      int64_t last = -1;
+      while (true) {
+        bool finished = done.load(std::memory_order_acquire);
+        if (!pipeline.Pop(block)) {
+          if (finished) {
+            return;
+          }
+          continue;
+        }
+        const uint32_t *data = (const uint32_t *)block.data;
+        in_order &= int64_t(data[0]) > last && block.frames == frames;
+        for (uint32_t i = 1; i < block.frames; i++) {
+          in_order &= data[i] == data[0] + i;
+        }
+        last = data[0];
+        analysed += block.frames;
+        pipeline.Release(block);
+      }
+    });
+    std::vector<uint32_t> packet(frames);
+    for (uint32_t p = 0; p < packets; p++) {
+      for (uint32_t i = 0; i < frames; i++) {
+        packet[i] = p * frames + i;
+      }
+      pipeline.Push((const uint8_t *)packet.data(), frames);
+    }
+    done.store(true, std::memory_order_release);
+    worker.join();
+    EXPECT(in_order)
+    PipelineStats stats = pipeline.GetStats();
+    EXPECT(analysed + stats.dropped_frames == uint64_t(packets) * frames)
+    std::cout << "stress: " << stats.dropped_blocks << " of " << stats.blocks
+              << " blocks dropped\n";
+  }
+
+  std::cout << "packet_pipeline_test passed\n";
+  return 0;
+}
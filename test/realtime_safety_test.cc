@@ -0,0 +1,255 @@
+#include "audio_thread.h"
+#include "tone_source.hpp"
+#include "expect.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Set while AudioThread handles a packet, see GuardedSource. Allocations
+// and mutex locks of that thread are counted while it is.
+static thread_local bool in_hot_path = false;
+static std::atomic<uint64_t> hot_allocations(0);
+static std::atomic<uint64_t> hot_locks(0);
+
+void *operator new(size_t size) {
+  if (in_hot_path) {
+    hot_allocations++;
+  }
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// every std::mutex, in this binary or in libstdc++, ends up here
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex) {
+  using LockFn = int (*)(pthread_mutex_t *);
+  static LockFn real = (LockFn)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+  if (in_hot_path) {
+    hot_locks++;
+  }
+  return real(mutex);
+}
+
+// Marks the callback of any source as the hot path, and Fill of one that
+// writes pipeline blocks itself unless `fill` is false.
+class GuardedSource : public AudioSource {
+public:
+  explicit GuardedSource(AudioSource *inner, bool fill = true)
+      : inner_(inner), fill_(fill && inner->CanFill()), fills_(0),
+        in_get_buffer_(false) {}
+  ~GuardedSource() override { delete inner_; }
+  void StartService() override { inner_->StartService(); }
+  void StopService() override { inner_->StopService(); }
+  void GetBuffer(StopFn stop, CallbackFn callback) override {
+    in_get_buffer_ = true;
+    inner_->GetBuffer(stop, [&](uint8_t *data, uint32_t frames) {
+      in_hot_path = true;
+      callback(data, frames);
+      in_hot_path = false;
+    });
+    in_get_buffer_ = false;
+  }
+  bool CanFill() const override { return fill_; }
+  uint32_t Fill(StopFn stop, uint8_t *dst, uint32_t max_frames) override {
+    in_hot_path = true;
+    uint32_t frames = inner_->Fill(stop, dst, max_frames);
+    in_hot_path = false;
+    fills_++;
+    return frames;
+  }
+  const AudioFormat &GetFormat() const override { return inner_->GetFormat(); }
+  bool IsExhausted() const override { return inner_->IsExhausted(); }
+
+  uint64_t GetFills() const { return fills_; }
+  // whether the capture thread is inside GetBuffer, packet callback included
+  bool InGetBuffer() const { return in_get_buffer_; }
+
+private:
+  AudioSource *inner_;
+  bool fill_;
+  uint64_t fills_; // read after the capture thread is joined
+  std::atomic<bool> in_get_buffer_;
+};
+
+// int16 packets, so the conversion path runs too
+class Int16Source : public AudioSource {
+public:
+  Int16Source(uint16_t channels, uint32_t total_frames)
+      : packet_(441 * channels), pos_(0), total_(total_frames) {
+    format_.sample_rate = 44100;
+    format_.channels = channels;
+    format_.bits_per_sample = 16;
+    format_.valid_bits = 16;
+    format_.block_align = 2 * channels;
+    format_.sample_type = SampleType::kInt16;
+  }
+  void StartService() override {}
+  void StopService() override {}
+  void GetBuffer(StopFn stop, CallbackFn callback) override {
+    if (this->IsExhausted() || stop()) {
+      return;
+    }
+    uint32_t frames = std::min<uint32_t>(441, total_ - pos_);
+    for (uint32_t i = 0; i < frames * format_.channels; i++) {
+      packet_[i] = int16_t(8000 * std::sin(0.1 * (pos_ + i / format_.channels)));
+    }
+    pos_ += frames;
+    callback((uint8_t *)packet_.data(), frames);
+  }
+  const AudioFormat &GetFormat() const override { return format_; }
+  bool IsExhausted() const override { return pos_ >= total_; }
+
+private:
+  AudioFormat format_;
+  std::vector<int16_t> packet_;
+  uint32_t pos_;
+  uint32_t total_;
+};
+
+// polls `done` until it holds or a deadline far past any expected wait
+template <class Pred> static bool WaitFor(Pred done) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+static void RunToEnd(AudioThread &thread) {
+  thread.Start();
+  while (!thread.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  thread.Stop();
+}
+
+int main() {
+  // the hooks are in place
+  in_hot_path = true;
+  {
+    std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    delete new int(1);
+  }
+  in_hot_path = false;
+  EXPECT(hot_allocations == 1 && hot_locks == 1)
+  hot_allocations = 0;
+  hot_locks = 0;
+
+  ToneConfig tone;
+  tone.noise = 0.1f;
+  tone.total_frames = 48000;
+
+  // every stage the capture thread can run, one configuration each
+  TaskPool pool(2);
+  std::vector<AnalysisConfig> configs(7);
+  configs[1].overlap = 0.75f;
+  configs[1].window = WindowType::kHann;
+  configs[1].channel_mode = ChannelMode::kPerChannel;
+  configs[1].smoothing = {4, 0.05f, 0.3f, true};
+  configs[1].resolutions.push_back({4096, 1024});
+  configs[2].channel_mode = ChannelMode::kMidSide;
+  configs[2].bands = BandScale::kMel;
+  configs[2].scale = SpectrumScale::kDecibels;
+  configs[3].constant_q = ConstantQConfig{110.0f};
+  configs[4].fft_size = FftSize::kFast;
+  configs[4].bands = BandScale::kThirdOctave;
+  // the capture thread only copies, or the source writes the blocks
+  // itself; the worker is not real-time
+  configs[5] = configs[1];
+  configs[5].pipeline = PipelineConfig{8, 256};
+  // nor does signalling a shared pool
+  configs[6] = configs[5];
+  configs[6].pool = &pool;
+  for (size_t i = 0; i < configs.size(); i++) {
+    const bool piped = configs[i].pipeline || configs[i].pool;
+    GuardedSource *filling = new GuardedSource(new ToneSource(tone));
+    AudioThread floats(configs[i], filling);
+    RunToEnd(floats);
+    EXPECT(floats.AcquireAmplitude().frame_id > 0)
+    EXPECT((filling->GetFills() > 0) == piped)
+    if (piped) {
+      // the same packets handed out for the capture thread to copy
+      AudioThread copied(configs[i],
+                         new GuardedSource(new ToneSource(tone), false));
+      RunToEnd(copied);
+      EXPECT(copied.AcquireAmplitude().frame_id > 0)
+    }
+    AudioThread ints(configs[i], new GuardedSource(new Int16Source(2, 44100)));
+    RunToEnd(ints);
+    EXPECT(ints.AcquireAmplitude().frame_id > 0)
+    if (hot_allocations || hot_locks) {
+      std::cout << "config " << i << ": " << hot_allocations
+                << " allocations, " << hot_locks << " locks\n";
+    }
+    EXPECT(hot_allocations == 0)
+    EXPECT(hot_locks == 0)
+  }
+
+  // what Run does for a source that fills pipeline blocks itself, with
+  // the pool full and not
+  {
+    PacketPipeline pipeline(PipelineConfig{2, 256}, 8);
+    TaskPool::StreamId stream = pool.Register([](void *) {}, nullptr);
+    std::vector<uint8_t> packet(600 * 8);
+    in_hot_path = true;
+    for (int i = 0; i < 4; i++) {
+      pipeline.BeginPush();
+      pipeline.CommitPush(256);
+      pipeline.Push(packet.data(), 600);
+      pool.Signal(stream);
+    }
+    in_hot_path = false;
+    pool.Unregister(stream);
+    EXPECT(hot_allocations == 0 && hot_locks == 0)
+  }
+
+  // pause parks the capture thread between packets, resume picks up
+  ToneConfig live = tone;
+  live.total_frames = 0;
+  live.realtime = true;
+  GuardedSource *guarded = new GuardedSource(new ToneSource(live));
+  AudioThread paced(AnalysisConfig{}, guarded);
+  paced.Start();
+  EXPECT(WaitFor([&] { return paced.AcquireAmplitude().frame_id > 0; }))
+  paced.Pause();
+  // once the packet in flight is done, a later GetBuffer sees the pause
+  // before it produces anything, so the thread is as good as parked
+  EXPECT(WaitFor([&] { return !guarded->InGetBuffer(); }))
+  uint64_t paused_at = paced.AcquireAmplitude().frame_id;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT(paced.AcquireAmplitude().frame_id == paused_at)
+  paced.Resume();
+  EXPECT(WaitFor([&] { return paced.AcquireAmplitude().frame_id > paused_at; }))
+  paced.Pause();
+  paced.Stop(); // stopping a paused thread wakes it up
+  EXPECT(hot_allocations == 0 && hot_locks == 0)
+
+  // the deferred log keeps lines in order and counts what did not fit
+  DeferredLog log(2);
+  log.Push("first ", 1);
+  log.Push("second");
+  log.Push("third");
+  std::ostringstream out;
+  log.Flush(out);
+  EXPECT(out.str() == "first 1\nsecond\n(1 log lines dropped)\n")
+
+  std::cout << "realtime_safety_test passed\n";
+  return 0;
+}
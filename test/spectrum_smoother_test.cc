@@ -0,0 +1,92 @@
+#include "spectrum_smoother.hpp"
+#include "expect.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+int main() {
+  // a spectrum every 10 ms, two bins
+  const float frame = 0.01f;
+  std::vector<float> x(2), peaks(2);
+
+  // running average of 4: a step reaches its value after 4 spectra
+  SmoothingConfig average;
+  average.average = 4;
+  SpectrumSmoother avg(average, 2, frame, 0.0f);
+  EXPECT(!avg.HasPeaks())
+  for (int f = 1; f <= 6; f++) {
+    x = {1.0f, 2.0f};
+    avg.Apply(x.data(), nullptr);
+    EXPECT(std::abs(x[0] - std::min(f, 4) / 4.0f) < 1e-6f)
+    EXPECT(std::abs(x[1] - std::min(f, 4) / 2.0f) < 1e-6f)
+  }
+  // ...and back down, exactly after a whole round
+  for (int f = 0; f < 4; f++) {
+    x = {0.0f, 0.0f};
+    avg.Apply(x.data(), nullptr);
+  }
+  EXPECT(x[0] == 0.0f && x[1] == 0.0f)
+
+  // fast attack, slow release: one time constant in, 1 - 1/e of the way
+  SmoothingConfig ar;
+  ar.attack = 0.01f;
+  ar.release = 0.1f;
+  SpectrumSmoother ease(ar, 2, frame, 0.0f);
+  x = {1.0f, 1.0f};
+  ease.Apply(x.data(), nullptr);
+  EXPECT(std::abs(x[0] - (1 - std::exp(-1.0f))) < 1e-6f)
+  for (int f = 0; f < 50; f++) {
+    x = {1.0f, 1.0f};
+    ease.Apply(x.data(), nullptr);
+  }
+  EXPECT(std::abs(x[0] - 1.0f) < 1e-6f)
+  for (int f = 0; f < 10; f++) {
+    x = {0.0f, 0.0f};
+    ease.Apply(x.data(), nullptr);
+  }
+  EXPECT(std::abs(x[0] - std::exp(-1.0f)) < 1e-4f)
+
+  // peaks in dB: held 50 ms, then falling 100 dB/s down to the signal
+  SmoothingConfig hold;
+  hold.peaks = true;
+  hold.peak_hold = 0.05f;
+  hold.peak_decay = 100.0f;
+  SpectrumSmoother peak(hold, 2, frame, kDecibelFloor);
+  EXPECT(peak.HasPeaks())
+  x = {-10.0f, -60.0f};
+  peak.Apply(x.data(), peaks.data());
+  EXPECT(x[0] == -10.0f) // the spectrum itself is untouched
+  EXPECT(peaks[0] == -10.0f && peaks[1] == -60.0f)
+  for (int f = 1; f <= 8; f++) {
+    x = {-40.0f, -50.0f};
+    peak.Apply(x.data(), peaks.data());
+    EXPECT(peaks[1] == -50.0f) // a higher value takes over at once
+    float expected = f <= 5 ? -10.0f : -10.0f - (f - 5) * 1.0f;
+    EXPECT(std::abs(peaks[0] - expected) < 1e-4f)
+  }
+  for (int f = 0; f < 40; f++) {
+    x = {-40.0f, -50.0f};
+    peak.Apply(x.data(), peaks.data());
+  }
+  EXPECT(peaks[0] == -40.0f)
+
+  // reset: nothing from before carries over, as after a gap in the input
+  x = {0.0f, 0.0f};
+  peak.Apply(x.data(), peaks.data());
+  peak.Reset();
+  x = {-40.0f, -50.0f};
+  peak.Apply(x.data(), peaks.data());
+  EXPECT(peaks[0] == -40.0f && peaks[1] == -50.0f)
+  for (int f = 0; f < 3; f++) {
+    x = {1.0f, 2.0f};
+    avg.Apply(x.data(), nullptr);
+  }
+  avg.Reset();
+  x = {1.0f, 2.0f};
+  avg.Apply(x.data(), nullptr);
+  EXPECT(std::abs(x[0] - 0.25f) < 1e-6f && std::abs(x[1] - 0.5f) < 1e-6f)
+
+  std::cout << "spectrum_smoother_test passed\n";
+  return 0;
+}
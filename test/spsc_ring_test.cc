@@ -0,0 +1,65 @@
+#include "spsc_ring.hpp"
+#include "expect.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main() {
+  const uint64_t count = 200000;
+  const size_t block_len = 256;
+
+  // every slot is filled with its sequence number, a torn read shows up as
+  // a block with mixed values
+  SpscRing<std::vector<uint64_t>> ring(8, std::vector<uint64_t>(block_len));
+  EXPECT(ring.Capacity() == 8)
+  EXPECT(ring.Front() == nullptr)
+
+  std::thread producer([&] {
+    for (uint64_t seq = 0; seq < count;) {
+      std::vector<uint64_t> *slot = ring.BeginPush();
+      if (slot == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      for (auto &v : *slot) {
+        v = seq;
+      }
+      ring.CommitPush();
+      seq++;
+    }
+  });
+
+  uint64_t expected = 0;
+  bool torn = false;
+  while (expected < count) {
+    std::vector<uint64_t> *slot = ring.Front();
+    if (slot == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (auto v : *slot) {
+      torn |= v != expected;
+    }
+    ring.Pop();
+    expected++;
+  }
+  producer.join();
+  EXPECT(!torn)
+  EXPECT(ring.Size() == 0)
+
+  // full ring refuses, never overwrites
+  SpscRing<int> small(2);
+  EXPECT(small.TryPush(1))
+  EXPECT(small.TryPush(2))
+  EXPECT(!small.TryPush(3))
+  int v = 0;
+  EXPECT(small.TryPop(v) && v == 1)
+  EXPECT(small.TryPush(3))
+  EXPECT(small.TryPop(v) && v == 2)
+  EXPECT(small.TryPop(v) && v == 3)
+  EXPECT(!small.TryPop(v))
+
+  std::cout << "spsc_ring_test passed\n";
+  return 0;
+}
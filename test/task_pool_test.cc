@@ -0,0 +1,178 @@
+#include "task_pool.hpp"
+#include "expect.h"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// counts its runs and whether two of them ever overlapped
+struct Counter {
+  std::atomic<uint32_t> runs{0};
+  std::atomic<bool> inside{false};
+  std::atomic<bool> overlapped{false};
+
+  static void Job(void *self) {
+    Counter *c = static_cast<Counter *>(self);
+    if (c->inside.exchange(true)) {
+      c->overlapped = true;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    c->runs++;
+    c->inside = false;
+  }
+};
+
+// runs until released, to keep a worker busy
+struct Blocker {
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+
+  static void Job(void *self) {
+    Blocker *b = static_cast<Blocker *>(self);
+    b->entered = true;
+    while (!b->release) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+};
+
+// appends its tag to a shared order when run
+struct Recorder {
+  std::vector<int> *order;
+  int tag;
+
+  static void Job(void *self) {
+    Recorder *r = static_cast<Recorder *>(self);
+    r->order->push_back(r->tag);
+  }
+};
+
+template <typename Cond> static bool WaitFor(Cond cond) {
+  for (int i = 0; i < 2000 && !cond(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return cond();
+}
+
+int main() {
+  // idle workers block: half a second of an idle 8 thread pool costs next
+  // to no cpu time, and a signal still runs at once
+  {
+    Counter counter;
+    TaskPool pool(8);
+    TaskPool::StreamId id = pool.Register(&Counter::Job, &counter);
+    std::clock_t start = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    double idle_seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+    EXPECT(idle_seconds < 0.005) // polling every 500 us costs ~0.02
+    pool.Signal(id);
+    EXPECT(WaitFor([&] { return pool.GetStats(id).runs == 1; }))
+    pool.Unregister(id);
+  }
+
+  // 16 streams on 4 threads: every signal is served, no job ever runs
+  // twice at once, signals while pending coalesce
+  {
+    TaskPool pool(4);
+    EXPECT(pool.GetThreadCount() == 4)
+    std::vector<Counter> counters(16);
+    std::vector<TaskPool::StreamId> ids;
+    for (Counter &c : counters) {
+      ids.push_back(pool.Register(&Counter::Job, &c));
+    }
+    for (int round = 0; round < 50; round++) {
+      for (TaskPool::StreamId id : ids) {
+        pool.Signal(id);
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+      EXPECT(WaitFor([&] {
+        return !counters[i].inside && pool.GetStats(ids[i]).runs ==
+                                          counters[i].runs;
+      }))
+      pool.Unregister(ids[i]);
+      EXPECT(counters[i].runs > 0 && counters[i].runs <= 50)
+      EXPECT(!counters[i].overlapped)
+    }
+  }
+
+  // with the only worker busy, what is ready runs by priority, then by
+  // the earliest deadline
+  {
+    std::vector<int> order;
+    Recorder low{&order, 0}, late{&order, 1}, soon{&order, 2}, high{&order, 3};
+    Blocker blocker;
+    bool entered;
+    uint64_t misses;
+    {
+      TaskPool pool(1);
+      TaskPool::StreamId b = pool.Register(&Blocker::Job, &blocker);
+      TaskPool::StreamId ids[] = {
+          pool.Register(&Recorder::Job, &low, {TaskPriority::kLow}),
+          pool.Register(&Recorder::Job, &late,
+                        {TaskPriority::kNormal, std::chrono::milliseconds(50)}),
+          pool.Register(&Recorder::Job, &soon,
+                        {TaskPriority::kNormal, std::chrono::milliseconds(5)}),
+          pool.Register(&Recorder::Job, &high, {TaskPriority::kHigh}),
+      };
+      pool.Signal(b);
+      entered = WaitFor([&] { return blocker.entered.load(); });
+      for (TaskPool::StreamId id : ids) {
+        pool.Signal(id);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      blocker.release = true;
+      WaitFor([&] { return pool.GetStats(ids[0]).runs == 1; });
+      misses = pool.GetStats(ids[2]).deadline_misses;
+    } // joined, order is ours to read
+    EXPECT(entered)
+    EXPECT((order == std::vector<int>{3, 2, 1, 0}))
+    // the 5 ms deadline passed while the blocker ran
+    EXPECT(misses == 1)
+  }
+
+  // a stream whose home worker is busy is stolen by an idle one: of two
+  // streams homed on one worker, one runs elsewhere while the other blocks
+  {
+    Blocker blocker;
+    Counter counter;
+    TaskPool pool(2);
+    TaskPool::StreamId b = pool.Register(&Blocker::Job, &blocker); // home 0
+    pool.Register(&Counter::Job, &counter);                        // home 1
+    TaskPool::StreamId c = pool.Register(&Counter::Job, &counter); // home 0
+    pool.Signal(b);
+    bool entered = WaitFor([&] { return blocker.entered.load(); });
+    pool.Signal(c);
+    bool ran = WaitFor([&] { return pool.GetStats(c).runs == 1; });
+    blocker.release = true;
+    EXPECT(entered && ran)
+    EXPECT(WaitFor([&] { return pool.GetStats(b).runs == 1; }))
+    EXPECT(pool.GetStats(b).steals + pool.GetStats(c).steals == 1)
+  }
+
+  // slots are reused after Unregister, never more than kMaxStreams at once
+  {
+    TaskPool pool(1);
+    Counter counter;
+    for (uint32_t i = 0; i < TaskPool::kMaxStreams; i++) {
+      pool.Register(&Counter::Job, &counter);
+    }
+    bool thrown = false;
+    try {
+      pool.Register(&Counter::Job, &counter);
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    EXPECT(thrown)
+    pool.Unregister(7);
+    EXPECT(pool.Register(&Counter::Job, &counter) == 7)
+  }
+
+  std::cout << "task_pool_test passed\n";
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "triple_buffer.hpp"
+#include "expect.h"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main() {
+  TripleBuffer<std::vector<uint64_t>> buffer(std::vector<uint64_t>(512, 0));
+  EXPECT(!buffer.Update())
+  EXPECT(buffer.Front()[0] == 0)
+
+  buffer.Back().assign(512, 1);
+  buffer.Publish();
+  buffer.Back().assign(512, 2);
+  buffer.Publish();
+  EXPECT(buffer.Update())
+  EXPECT(buffer.Front()[0] == 2) // newest wins
+  EXPECT(!buffer.Update())
+  EXPECT(buffer.Front()[511] == 2) // and stays put
+
+  // the reader never sees a mixed value and ids never go backwards
+  const uint64_t count = 200000;
+  std::atomic_bool done(false);
+  std::thread writer([&] {
+    for (uint64_t id = 3; id <= count; id++) {
+      for (auto &v : buffer.Back()) {
+        v = id;
+      }
+      buffer.Publish();
+    }
+    done = true;
+  });
+  uint64_t last = 2;
+  bool torn = false, backwards = false;
+  while (!done || buffer.Update()) {
+    buffer.Update();
+    const std::vector<uint64_t> &front = buffer.Front();
+    for (auto v : front) {
+      torn |= v != front[0];
+    }
+    backwards |= front[0] < last;
+    last = front[0];
+  }
+  writer.join();
+  EXPECT(!torn)
+  EXPECT(!backwards)
+  EXPECT(last == count)
+
+  std::cout << "triple_buffer_test passed\n";
+  return 0;
+}
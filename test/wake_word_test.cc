@@ -0,0 +1,62 @@
+#include "wake_word.hpp"
+#include "expect.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+int main() {
+  // a waiter with nothing to wait for blocks instead of spinning, and a
+  // notify gets it going
+  {
+    WakeWord wake;
+    std::atomic<bool> go(false);
+    std::atomic<uint32_t> wakeups(0);
+    std::thread waiter([&] {
+      while (true) {
+        uint32_t seen = wake.Prepare();
+        if (go) {
+          return;
+        }
+        wake.Wait(seen);
+        wakeups++;
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+#if defined(__linux__) || defined(_WIN32)
+    EXPECT(wakeups <= 1) // spurious ones are allowed, a timer is not
+#endif
+    go = true;
+    wake.Notify();
+    waiter.join();
+  }
+
+  // a consumer sleeping whenever it has caught up never misses an item,
+  // however the notifies fall between its look and its wait
+  {
+    WakeWord wake;
+    const uint32_t items = 200000;
+    std::atomic<uint32_t> produced(0);
+    uint32_t consumed = 0;
+    std::thread consumer([&] {
+      while (consumed < items) {
+        uint32_t seen = wake.Prepare();
+        uint32_t available = produced.load(std::memory_order_acquire);
+        if (available == consumed) {
+          wake.Wait(seen);
+        }
+        consumed = available;
+      }
+    });
+    for (uint32_t i = 0; i < items; i++) {
+      produced.fetch_add(1, std::memory_order_release);
+      wake.Notify();
+    }
+    consumer.join();
+    EXPECT(consumed == items)
+  }
+
+  std::cout << "wake_word_test passed\n";
+  return 0;
+}
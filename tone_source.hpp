@@ -0,0 +1,129 @@
+#ifndef TONE_SOURCE_HPP
+#define TONE_SOURCE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread> // sleep_for
+#include <vector>
+
+#include "audio_source.hpp"
+
+struct ToneConfig {
+  uint32_t sample_rate = 48000;
+  uint16_t channels = 2;
+  std::vector<float> freqs = {1000.0f}; // Hz, summed on every channel
+  float amplitude = 0.5f;               // peak amplitude of each tone
+  float noise = 0.0f;                   // peak amplitude of white noise
+  uint32_t seed = 1;                    // noise seed, same seed same output
+  uint32_t packet_frames = 480;         // frames per callback
+  uint64_t total_frames = 0;            // 0: never exhausted
+  bool realtime = false;                // pace packets like a device would
+};
+
+// Deterministic float32 generator of sine tones plus white noise. With
+// `realtime` off packets are produced as fast as the consumer takes them,
+// which is what benchmarks and regression tests want.
+class ToneSource : public AudioSource {
+public:
+  explicit ToneSource(const ToneConfig &config)
+      : config_(config), phases_(config.freqs.size(), 0.0),
+        packet_(config.packet_frames * config.channels), packet_left_(0),
+        frame_pos_(0),
+        noise_state_(config.seed ? config.seed : 1) {
+    format_.sample_rate = config_.sample_rate;
+    format_.channels = config_.channels;
+    format_.bits_per_sample = sizeof(float) * 8;
+    format_.valid_bits = format_.bits_per_sample;
+    format_.block_align = sizeof(float) * config_.channels;
+    format_.sample_type = SampleType::kFloat32;
+  }
+
+  void StartService() override {
+    next_packet_time_ = std::chrono::steady_clock::now();
+  }
+  void StopService() override {}
+
+  void GetBuffer(StopFn stop, CallbackFn callback) override {
+    if (this->IsExhausted() || stop()) {
+      return;
+    }
+    uint32_t frame_num = this->NextPacket();
+    this->Generate(packet_.data(), frame_num);
+    callback((uint8_t *)packet_.data(), frame_num);
+  }
+
+  bool CanFill() const override { return true; }
+  uint32_t Fill(StopFn stop, uint8_t *dst, uint32_t max_frames) override {
+    if (this->IsExhausted() || stop()) {
+      return 0;
+    }
+    if (packet_left_ == 0) {
+      packet_left_ = this->NextPacket();
+    }
+    uint32_t frame_num = std::min(packet_left_, max_frames);
+    this->Generate((float *)dst, frame_num);
+    packet_left_ -= frame_num;
+    return frame_num;
+  }
+
+  const AudioFormat &GetFormat() const override { return format_; }
+
+  bool IsExhausted() const override {
+    return config_.total_frames != 0 && frame_pos_ >= config_.total_frames;
+  }
+
+private:
+  // waits for the packet's time when realtime, returns its frames
+  uint32_t NextPacket() {
+    if (config_.realtime) {
+      next_packet_time_ += std::chrono::microseconds(
+          uint64_t(config_.packet_frames) * 1000000 / config_.sample_rate);
+      std::this_thread::sleep_until(next_packet_time_);
+    }
+    uint32_t frame_num = config_.packet_frames;
+    if (config_.total_frames != 0 &&
+        config_.total_frames - frame_pos_ < frame_num) {
+      frame_num = uint32_t(config_.total_frames - frame_pos_);
+    }
+    return frame_num;
+  }
+
+  void Generate(float *dst, uint32_t frame_num) {
+    const double two_pi = 2.0 * 3.14159265358979323846;
+    for (uint32_t i = 0; i < frame_num; i++) {
+      float tone = 0.0f;
+      for (size_t t = 0; t < phases_.size(); t++) {
+        tone += config_.amplitude * (float)std::sin(phases_[t]);
+        phases_[t] += two_pi * config_.freqs[t] / config_.sample_rate;
+        if (phases_[t] >= two_pi) {
+          phases_[t] -= two_pi;
+        }
+      }
+      for (uint16_t c = 0; c < config_.channels; c++) {
+        dst[i * config_.channels + c] =
+            tone + config_.noise * this->NextNoise();
+      }
+    }
+    frame_pos_ += frame_num;
+  }
+
+  // xorshift32 mapped to [-1, 1)
+  float NextNoise() {
+    noise_state_ ^= noise_state_ << 13;
+    noise_state_ ^= noise_state_ >> 17;
+    noise_state_ ^= noise_state_ << 5;
+    return (float)(noise_state_ >> 8) / float(1 << 23) - 1.0f;
+  }
+
+  ToneConfig config_;
+  AudioFormat format_;
+  std::vector<double> phases_;
+  std::vector<float> packet_;
+  uint32_t packet_left_; // frames of the packet Fill has not written yet
+  uint64_t frame_pos_;
+  uint32_t noise_state_;
+  std::chrono::steady_clock::time_point next_packet_time_;
+};
+
+#endif
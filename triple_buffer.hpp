@@ -0,0 +1,49 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Latest-value publication between one writer and one reader.
+//
+// The writer fills Back() and Publish()es it by swapping its index with the
+// shared middle slot; the reader Update()s by swapping the middle slot with
+// its Front() when a new value is waiting. Each side owns its own slot in
+// between, so neither copies, waits or sees a half-written value. The
+// reader always gets the newest published value, older ones are skipped.
+template <typename T> class TripleBuffer {
+  static constexpr uint8_t kDirty = 0x4; // middle holds an unread value
+  static constexpr uint8_t kIndex = 0x3;
+
+public:
+  explicit TripleBuffer(const T &init = T())
+      : buffers_{init, init, init}, middle_(1), back_(0), front_(2) {}
+
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  // writer side
+  T &Back() { return buffers_[back_]; }
+  void Publish() {
+    back_ = middle_.exchange(back_ | kDirty, std::memory_order_acq_rel) &
+            kIndex;
+  }
+
+  // reader side, returns false if nothing new was published since last time
+  bool Update() {
+    if ((middle_.load(std::memory_order_relaxed) & kDirty) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+    return true;
+  }
+  const T &Front() const { return buffers_[front_]; }
+
+private:
+  T buffers_[3];
+  alignas(64) std::atomic<uint8_t> middle_;
+  alignas(64) uint8_t back_;  // writer only
+  alignas(64) uint8_t front_; // reader only
+};
+
+#endif
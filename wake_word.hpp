@@ -0,0 +1,86 @@
+#ifndef WAKE_WORD_HPP
+#define WAKE_WORD_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Lets threads with nothing to do block until another thread has news for
+// them, without a lock on the notifying side: a counter in a futex on
+// Linux (WaitOnAddress on Windows). Notify is an atomic increment and,
+// only when someone sleeps, one system call, so a real-time thread may
+// call it. A waiter reads Prepare() before it looks for work and passes
+// it to Wait, so a Notify in between is never lost:
+//
+//   uint32_t seen = wake.Prepare();
+//   if (!FindWork()) wake.Wait(seen);
+//
+// Elsewhere, where futexes are missing, Wait sleeps kFallbackSleep.
+class WakeWord {
+public:
+  static constexpr std::chrono::microseconds kFallbackSleep{500};
+
+  WakeWord() : word_(0), sleepers_(0) {}
+  WakeWord(const WakeWord &) = delete;
+  WakeWord &operator=(const WakeWord &) = delete;
+
+  uint32_t Prepare() const { return word_.load(std::memory_order_seq_cst); }
+
+  // Returns after a Notify later than the Prepare that gave `seen`, maybe
+  // sooner; callers look for work again either way.
+  void Wait(uint32_t seen) {
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+#if defined(_WIN32)
+    WaitOnAddress(Address(), &seen, sizeof(seen), INFINITE);
+#elif defined(__linux__)
+    syscall(SYS_futex, Address(), FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr,
+            0);
+#else
+    if (word_.load(std::memory_order_seq_cst) == seen) {
+      std::this_thread::sleep_for(kFallbackSleep);
+    }
+#endif
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Any thread, never locks: wakes one waiter, or all of them.
+  void Notify(bool all = false) {
+    word_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) == 0) {
+      return; // whoever is about to wait sees the new word
+    }
+#if defined(_WIN32)
+    if (all) {
+      WakeByAddressAll(Address());
+    } else {
+      WakeByAddressSingle(Address());
+    }
+#elif defined(__linux__)
+    syscall(SYS_futex, Address(), FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1,
+            nullptr, nullptr, 0);
+#else
+    (void)all;
+#endif
+  }
+
+private:
+  // the kernel compares and waits on the atomic's own 32 bits
+  uint32_t *Address() { return reinterpret_cast<uint32_t *>(&word_); }
+
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex words are plain 32 bit integers");
+  std::atomic<uint32_t> word_;
+  std::atomic<uint32_t> sleepers_;
+};
+
+#endif
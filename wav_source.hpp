@@ -0,0 +1,135 @@
+#ifndef WAV_SOURCE_HPP
+#define WAV_SOURCE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread> // sleep_until
+#include <vector>
+
+#include "audio_source.hpp"
+
+// Replays a RIFF/WAVE file as interleaved packets in the file's own sample
+// format (PCM 16/24/32, float 32/64). The whole file is read up front so
+// packets can be delivered faster than real time.
+class WavFileSource : public AudioSource {
+  static constexpr uint16_t kFormatPcm = 0x0001;
+  static constexpr uint16_t kFormatFloat = 0x0003;
+  static constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+public:
+  WavFileSource(const std::string &path, uint32_t packet_frames = 480,
+                bool realtime = false, bool loop = false)
+      : packet_frames_(packet_frames), realtime_(realtime), loop_(loop),
+        frame_pos_(0), frame_len_(0) {
+    this->Load(path);
+  }
+
+  void StartService() override {
+    next_packet_time_ = std::chrono::steady_clock::now();
+  }
+  void StopService() override {}
+
+  void GetBuffer(StopFn stop, CallbackFn callback) override {
+    if (this->IsExhausted() || stop()) {
+      return;
+    }
+    if (frame_pos_ == frame_len_) {
+      frame_pos_ = 0; // looping
+    }
+    uint32_t frame_num = packet_frames_;
+    if (frame_len_ - frame_pos_ < frame_num) {
+      frame_num = uint32_t(frame_len_ - frame_pos_);
+    }
+    if (realtime_) {
+      next_packet_time_ += std::chrono::microseconds(
+          uint64_t(frame_num) * 1000000 / format_.sample_rate);
+      std::this_thread::sleep_until(next_packet_time_);
+    }
+    callback(data_.data() + frame_pos_ * format_.block_align, frame_num);
+    frame_pos_ += frame_num;
+  }
+
+  const AudioFormat &GetFormat() const override { return format_; }
+
+  bool IsExhausted() const override {
+    return frame_len_ == 0 || (!loop_ && frame_pos_ >= frame_len_);
+  }
+
+private:
+  template <typename T> static T ReadLE(const uint8_t *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T)); // RIFF is little endian, like our targets
+    return v;
+  }
+
+  void Load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("Cannot open wav file: " + path);
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+    if (bytes.size() < 12 || std::memcmp(bytes.data(), "RIFF", 4) != 0 ||
+        std::memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+      throw std::runtime_error("Not a RIFF/WAVE file: " + path);
+    }
+
+    uint16_t format_tag = 0;
+    const uint8_t *data = nullptr;
+    size_t data_len = 0;
+    size_t pos = 12;
+    while (pos + 8 <= bytes.size()) {
+      const uint8_t *chunk = bytes.data() + pos;
+      size_t chunk_len = ReadLE<uint32_t>(chunk + 4);
+      size_t body_len = std::min(chunk_len, bytes.size() - pos - 8);
+      if (std::memcmp(chunk, "fmt ", 4) == 0 && body_len >= 16) {
+        format_tag = ReadLE<uint16_t>(chunk + 8);
+        format_.channels = ReadLE<uint16_t>(chunk + 10);
+        format_.sample_rate = ReadLE<uint32_t>(chunk + 12);
+        format_.bits_per_sample = ReadLE<uint16_t>(chunk + 22);
+        format_.valid_bits = format_.bits_per_sample;
+        if (format_tag == kFormatExtensible && body_len >= 40) {
+          uint16_t valid_bits = ReadLE<uint16_t>(chunk + 26);
+          format_.valid_bits = valid_bits ? valid_bits : format_.valid_bits;
+          // first two bytes of the SubFormat GUID hold the plain format tag
+          format_tag = ReadLE<uint16_t>(chunk + 32);
+        }
+      } else if (std::memcmp(chunk, "data", 4) == 0) {
+        data = chunk + 8;
+        data_len = body_len;
+      }
+      pos += 8 + chunk_len + (chunk_len & 1);
+    }
+    if (data == nullptr || format_.channels == 0) {
+      throw std::runtime_error("Missing fmt or data chunk: " + path);
+    }
+
+    if (format_tag == kFormatFloat || format_tag == kFormatPcm) {
+      format_.sample_type =
+          ToSampleType(format_tag == kFormatFloat, format_.bits_per_sample);
+    }
+    if (format_.sample_type == SampleType::kUnsupported) {
+      throw std::runtime_error("Unsupported wav sample format: " + path);
+    }
+
+    format_.block_align = format_.bits_per_sample / 8 * format_.channels;
+    frame_len_ = data_len / format_.block_align;
+    data_.assign(data, data + frame_len_ * format_.block_align);
+  }
+
+  AudioFormat format_;
+  std::vector<uint8_t> data_;
+  uint32_t packet_frames_;
+  bool realtime_;
+  bool loop_;
+  uint64_t frame_pos_;
+  uint64_t frame_len_;
+  std::chrono::steady_clock::time_point next_packet_time_;
+};
+
+#endif
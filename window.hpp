@@ -0,0 +1,121 @@
+#ifndef WINDOW_HPP
+#define WINDOW_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+enum class WindowType {
+  kRectangular,
+  kHann,
+  kHamming,
+  kBlackmanHarris, // 4 term, -92 dB side lobes
+  kFlatTop,        // amplitude accurate to ~0.01 dB anywhere in the bin
+  kKaiser,         // side lobes / main lobe trade off through beta
+};
+
+// Window coefficients, periodic (DFT-even) as spectral analysis wants them.
+struct Window {
+  std::vector<float> coeffs;
+  float coherent_gain; // mean of coeffs, divide amplitudes by it
+  // equivalent noise bandwidth in bins, len * sum(w^2) / sum(w)^2: a sine
+  // spreads this many bins' worth of its power, divide summed powers by it
+  float noise_bandwidth;
+};
+
+namespace window_detail {
+// zeroth order modified Bessel function of the first kind
+inline double BesselI0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 64 && term > 1e-12 * sum; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+inline double Cosines(const double *a, int terms, double phase) {
+  double w = 0.0;
+  for (int k = 0; k < terms; k++) {
+    w += (k % 2 ? -a[k] : a[k]) * std::cos(k * phase);
+  }
+  return w;
+}
+
+inline std::shared_ptr<const Window> Compute(WindowType type, uint32_t len,
+                                             float beta) {
+  static const double hann[] = {0.5, 0.5};
+  static const double hamming[] = {0.54, 0.46};
+  static const double blackman_harris[] = {0.35875, 0.48829, 0.14128,
+                                           0.01168};
+  static const double flat_top[] = {0.21557895, 0.41663158, 0.277263158,
+                                    0.083578947, 0.006947368};
+  const double two_pi = 2.0 * 3.14159265358979323846;
+
+  auto window = std::make_shared<Window>();
+  window->coeffs.resize(len);
+  double sum = 0.0, sum_sq = 0.0;
+  for (uint32_t i = 0; i < len; i++) {
+    double phase = two_pi * i / len;
+    double w = 1.0;
+    switch (type) {
+    case WindowType::kRectangular:
+      break;
+    case WindowType::kHann:
+      w = Cosines(hann, 2, phase);
+      break;
+    case WindowType::kHamming:
+      w = Cosines(hamming, 2, phase);
+      break;
+    case WindowType::kBlackmanHarris:
+      w = Cosines(blackman_harris, 4, phase);
+      break;
+    case WindowType::kFlatTop:
+      w = Cosines(flat_top, 5, phase);
+      break;
+    case WindowType::kKaiser: {
+      double r = 2.0 * i / len - 1.0;
+      w = BesselI0(beta * std::sqrt(1.0 - r * r)) / BesselI0(beta);
+      break;
+    }
+    }
+    window->coeffs[i] = (float)w;
+    sum += w;
+    sum_sq += w * w;
+  }
+  window->coherent_gain = len ? (float)(sum / len) : 1.0f;
+  window->noise_bandwidth = len ? (float)(len * sum_sq / (sum * sum)) : 1.0f;
+  return window;
+}
+} // namespace window_detail
+
+// Coefficients are computed once per (type, len, beta) and shared by every
+// caller holding them; they are freed with the last holder, and their
+// cache entry with the next miss. `beta` is only
+// used by kKaiser.
+inline std::shared_ptr<const Window> GetWindow(WindowType type, uint32_t len,
+                                               float beta = 8.6f) {
+  using Key = std::tuple<WindowType, uint32_t, float>;
+  static std::mutex mutex;
+  static std::map<Key, std::weak_ptr<const Window>> cache;
+
+  Key key(type, len, type == WindowType::kKaiser ? beta : 0.0f);
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const Window> window = cache[key].lock();
+  if (!window) {
+    // drop what nobody holds any more, or every size ever asked stays
+    for (auto it = cache.begin(); it != cache.end();) {
+      it = it->second.expired() ? cache.erase(it) : std::next(it);
+    }
+    window = window_detail::Compute(type, len, beta);
+    cache[key] = window;
+  }
+  return window;
+}
+
+#endif